@@ -10,12 +10,16 @@ pushd %projdir%\build
 ::
 
 :: Preproc flags
-:: -DINTERNAL_BUILD : is it debug build?
+:: -DINTERNAL_BUILD        : is it debug build?
+:: -DGUI_COMPACT_VERTICES  : 12 byte ui vertices (fixed point positions, normalized uvs),
+::                          positions must stay within -4096 to 4095.875 pixels of their draw origin
+:: -DGUI_SOA_VERTICES      : one stream per vertex attribute, quads are written with sse2
 set cplflags=-DINTERNAL_BUILD=1
 
 :: Optimization flags
 :: -Oi : generate intrinsic funcs
 :: -Od : disable optimization
+:: -O2 : maximize speed, use it without INTERNAL_BUILD when comparing the vertex stream benchmark
 set cplflags=%cplflags% -Oi -Od
 
 :: Preprocessor output
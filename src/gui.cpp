@@ -6,8 +6,9 @@
 #define STBTT_acos          acos32
 #define STBTT_fabs          abs32
 #define STBTT_fmod          mod32
-#define STBTT_malloc(x, u)  platform.virtual_alloc(x)
-#define STBTT_free(x, u)    platform.virtual_free(x)
+// NOTE(dan): with a memory stack as the user data of the font, allocations are pushed onto it and freed with it
+#define STBTT_malloc(x, u)  ((u) ? push_size((MemoryStack *)(u), (x), align_no_clear(16)) : platform.virtual_alloc(x))
+#define STBTT_free(x, u)    ((u) ? (void)0 : platform.virtual_free(x))
 #define STBTT_assert        assert
 #define STBTT_strlen        string_length
 #define STBTT_memcpy        copy_memory
@@ -18,141 +19,1501 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-#define MAX_NUM_VERTICES 8192
-#define MAX_NUM_ELEMENTS 8192
+// NOTE(dan): enough for polylines of 100k points
+#define MAX_NUM_VERTICES (1 << 18)
+#define MAX_NUM_ELEMENTS (3 << 18)
+#define MAX_NUM_INSTANCES 8192
+#define MAX_NUM_SHAPES 4096
+#define MAX_NUM_DRAW_COMMANDS 1024
+
+// NOTE(dan): quads are drawn in batches of at most this many, so the static quad elements fit in u16
+#define MAX_NUM_QUADS_PER_BATCH 16384
 
 #include "format_string.h"
 
-#include "gui.h"
-#include "gui_data.h"
-#include "gui_draw.cpp"
-#include "gui_elements.cpp"
+#include "gui.h"
+#include "gui_data.h"
+#include "gui_draw.cpp"
+#include "gui_elements.cpp"
+
+struct AppState
+{
+    MemoryStack app_memory;
+
+    UIState ui_state;
+};
+
+static void opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar *message, GLvoid *user_param)
+{
+    if (severity == GL_DEBUG_SEVERITY_HIGH)
+    {
+        char *error = (char *)message;
+        assert(!error);
+    }
+}
+
+static void init_stream_buffer(StreamBuffer *stream, GLenum target, u32 region_size, b32 persistent)
+{
+    GLsizeiptr buffer_size = (GLsizeiptr)region_size * NUM_STREAM_REGIONS;
+
+    stream->target = target;
+    stream->region_size = region_size;
+    stream->mapped_base = 0;
+
+    gl.GenBuffers(1, &stream->buffer);
+    gl.BindBuffer(target, stream->buffer);
+
+    if (persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        // NOTE(dan): dynamic storage for BufferSubData with retained buffers
+        gl.BufferStorage(target, buffer_size, 0, flags | GL_DYNAMIC_STORAGE_BIT);
+        stream->mapped_base = (u8 *)gl.MapBufferRange(target, 0, buffer_size, flags);
+        assert(stream->mapped_base);
+    }
+    else
+    {
+        gl.BufferData(target, buffer_size, 0, GL_STREAM_DRAW);
+    }
+}
+
+static void *map_stream_region(StreamBuffer *stream, u32 region_index)
+{
+    void *region = 0;
+    u32 region_offset = region_index * stream->region_size;
+
+    if (stream->mapped_base)
+    {
+        region = stream->mapped_base + region_offset;
+    }
+    else
+    {
+        // NOTE(dan): the fence of the region already guarantees that the gpu is done with it
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+        gl.BindBuffer(stream->target, stream->buffer);
+        region = gl.MapBufferRange(stream->target, region_offset, stream->region_size, access);
+        assert(region);
+    }
+    return region;
+}
+
+static void unmap_stream_region(StreamBuffer *stream)
+{
+    if (!stream->mapped_base)
+    {
+        gl.BindBuffer(stream->target, stream->buffer);
+        gl.UnmapBuffer(stream->target);
+    }
+}
+
+static void init_upload_stream(UploadStream *upload_stream, StreamBuffer *stream, UploadCounter counter, u32 element_size, MemoryStack *memory)
+{
+    upload_stream->stream = stream;
+    upload_stream->counter = counter;
+    upload_stream->element_size = element_size;
+    upload_stream->staging = (u8 *)push_size(memory, stream->region_size, no_clear());
+}
+
+static void wait_for_stream_region(UIState *ui)
+{
+    u32 region_index = ui->stream_region_index;
+    GLsync fence = ui->stream_fences[region_index];
+    if (fence)
+    {
+        // NOTE(dan): with three regions this only blocks when the gpu is more than two frames behind
+        GLbitfield flags = 0;
+        GLuint64 timeout = 0;
+        for (;;)
+        {
+            GLenum wait_result = gl.ClientWaitSync(fence, flags, timeout);
+            if (wait_result == GL_ALREADY_SIGNALED || wait_result == GL_CONDITION_SATISFIED || wait_result == GL_WAIT_FAILED)
+            {
+                assert(wait_result != GL_WAIT_FAILED);
+                break;
+            }
+
+            flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            timeout = 1000000000;
+        }
+
+        gl.DeleteSync(fence);
+        ui->stream_fences[region_index] = 0;
+    }
+}
+
+static void begin_stream_region(UIState *ui)
+{
+    u32 region_index = ui->stream_region_index;
+
+    // NOTE(dan): the region has to be uploaded completely on the first retained frame
+    if (ui->retained_buffers && !ui->frame_retained)
+    {
+        ui->num_prev_upload_segments = 0;
+    }
+    ui->frame_retained = ui->retained_buffers;
+
+    u8 *streams[NUM_UPLOAD_STREAMS];
+    if (ui->frame_retained)
+    {
+        // NOTE(dan): BufferSubData synchronizes with the gpu by itself
+        for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+        {
+            streams[stream_index] = ui->upload_streams[stream_index].staging;
+        }
+    }
+    else
+    {
+        wait_for_stream_region(ui);
+        for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+        {
+            streams[stream_index] = (u8 *)map_stream_region(ui->upload_streams[stream_index].stream, region_index);
+        }
+    }
+    set_stream_pointers(ui, streams);
+}
+
+static void end_stream_region(UIState *ui)
+{
+    u32 region_index = ui->stream_region_index;
+
+    // NOTE(dan): retained frames stay in their region, the fence is only there for when streaming starts again
+    if (ui->stream_fences[region_index])
+    {
+        assert(ui->frame_retained);
+        gl.DeleteSync(ui->stream_fences[region_index]);
+    }
+    ui->stream_fences[region_index] = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (!ui->frame_retained)
+    {
+        ui->stream_region_index = (region_index + 1) % NUM_STREAM_REGIONS;
+    }
+}
+
+inline b32 is_upload_segment_clean(UIState *ui, u32 segment_index)
+{
+    b32 clean = false;
+    if (segment_index < ui->num_prev_upload_segments)
+    {
+        UploadSegment *segment = ui->upload_segments + segment_index;
+        UploadSegment *prev_segment = ui->prev_upload_segments + segment_index;
+
+        clean = (segment->hash == prev_segment->hash);
+        for (u32 counter = 0; clean && counter < UploadCounter_Count; ++counter)
+        {
+            clean = (segment->begin[counter] == prev_segment->begin[counter] && segment->end[counter] == prev_segment->end[counter]);
+        }
+    }
+    return clean;
+}
+
+static u32 upload_stream_range(UIState *ui, UploadStream *upload_stream, u32 begin, u32 end)
+{
+    StreamBuffer *stream = upload_stream->stream;
+    u32 offset = begin * upload_stream->element_size;
+    u32 size = (end - begin) * upload_stream->element_size;
+
+    if (size)
+    {
+        GLintptr region_offset = (GLintptr)ui->stream_region_index * stream->region_size + offset;
+
+        gl.BindBuffer(stream->target, stream->buffer);
+        gl.BufferSubData(stream->target, region_offset, size, upload_stream->staging + offset);
+    }
+    return size;
+}
+
+// NOTE(dan): segments follow each other in every stream, so a run of dirty segments is one BufferSubData per stream
+static u32 upload_dirty_segments(UIState *ui)
+{
+    u32 num_bytes_uploaded = 0;
+    close_upload_segment(ui);
+
+    u32 segment_index = 0;
+    while (segment_index < ui->num_upload_segments)
+    {
+        if (is_upload_segment_clean(ui, segment_index))
+        {
+            ++segment_index;
+        }
+        else
+        {
+            UploadSegment *first_segment = ui->upload_segments + segment_index;
+            while (segment_index < ui->num_upload_segments && !is_upload_segment_clean(ui, segment_index))
+            {
+                ++segment_index;
+            }
+            UploadSegment *last_segment = ui->upload_segments + segment_index - 1;
+
+            for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+            {
+                UploadStream *upload_stream = ui->upload_streams + stream_index;
+                u32 counter = upload_stream->counter;
+                num_bytes_uploaded += upload_stream_range(ui, upload_stream, first_segment->begin[counter], last_segment->end[counter]);
+            }
+        }
+    }
+
+    UploadSegment *segments = ui->prev_upload_segments;
+    ui->prev_upload_segments = ui->upload_segments;
+    ui->num_prev_upload_segments = ui->num_upload_segments;
+    ui->upload_segments = segments;
+    ui->num_upload_segments = 0;
+
+    for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+    {
+        ui->upload_segment_begin[counter] = 0;
+    }
+    return num_bytes_uploaded;
+}
+
+static GLuint create_quad_element_buffer(MemoryStack *memory)
+{
+    GLuint buffer = 0;
+    TempMemoryStack temp_memory = begin_temp_memory(memory);
+    {
+        u32 num_elements = MAX_NUM_QUADS_PER_BATCH * 6;
+        u16 *elements = push_array(memory, num_elements, u16, no_clear());
+
+        for (u32 quad_index = 0; quad_index < MAX_NUM_QUADS_PER_BATCH; ++quad_index)
+        {
+            u16 *element = elements + quad_index * 6;
+            u32 vertice_index = quad_index * 4;
+
+            element[0] = (u16)(vertice_index + 0);
+            element[1] = (u16)(vertice_index + 1);
+            element[2] = (u16)(vertice_index + 2);
+            element[3] = (u16)(vertice_index + 0);
+            element[4] = (u16)(vertice_index + 2);
+            element[5] = (u16)(vertice_index + 3);
+        }
+
+        gl.GenBuffers(1, &buffer);
+        gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        gl.BufferData(GL_ELEMENT_ARRAY_BUFFER, num_elements * sizeof(u16), elements, GL_STATIC_DRAW);
+    }
+    end_temp_memory(temp_memory);
+    return buffer;
+}
+
+// NOTE(dan): returns the slot to draw the texture with, textures keep their slot for as long as the ui lives
+static u32 add_texture_slot(UIState *ui, GLuint texture)
+{
+    assert(ui->num_texture_slots < PANEL_TEXTURE_SLOT);
+
+    u32 slot = ui->num_texture_slots++;
+    ui->texture_slots[slot] = texture;
+    return slot;
+}
+
+inline void set_texture_slot(UIState *ui, u32 slot, GLuint texture)
+{
+    assert(slot < ui->num_texture_slots);
+    ui->texture_slots[slot] = texture;
+}
+
+static void init_ui(UIState *ui, PlatformInput *input, PlatformWorkQueue *work_queue)
+{
+    ui->input = input;
+    ui->work_queue = work_queue;
+
+    ui->num_vertices = 0;
+    ui->num_elements = 0;
+    ui->num_instances = 0;
+    ui->num_shapes = 0;
+    ui->num_commands = 0;
+    ui->command_barrier = 0;
+    ui->immediate_packet.commands = push_array(&ui->memory, MAX_NUM_DRAW_COMMANDS, DrawCommand);
+    ui->immediate_packet.render_ops = push_array(&ui->memory, MAX_NUM_RENDER_OPS, RenderOp, no_clear());
+    ui->packet = &ui->immediate_packet;
+    ui->commands = ui->packet->commands;
+    ui->frame_packets = push_array(&ui->memory, NUM_FRAME_PACKETS, FramePacket);
+    ui->pipelined = false;
+    ui->num_panel_jobs = 0;
+    ui->panel_jobs = push_array(&ui->memory, MAX_NUM_PANEL_JOBS, PanelJob);
+
+    ui->root_panel = create_panel(ui, "Root Panel");
+
+    char error[1024];
+    ui->program = opengl_create_program(ui_vertex_shader, ui_fragment_shader, error, sizeof(error));
+
+    gl.GenVertexArrays(1, &ui->vao);
+    gl.BindVertexArray(ui->vao);
+
+    // NOTE(dan): fall back to mapping each region unsynchronized when there is no GL_ARB_buffer_storage
+    ui->persistent_streams = (gl.BufferStorage != 0);
+    ui->stream_region_index = 0;
+
+#if GUI_SOA_VERTICES
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+        init_stream_buffer(ui->vertex_streams + attrib_##name, GL_ARRAY_BUFFER, MAX_NUM_VERTICES * sizeof(type), ui->persistent_streams);
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+#else
+    init_stream_buffer(ui->vertex_streams + 0, GL_ARRAY_BUFFER, MAX_NUM_VERTICES * sizeof(Vertex), ui->persistent_streams);
+#endif
+    init_stream_buffer(&ui->element_stream, GL_ELEMENT_ARRAY_BUFFER, MAX_NUM_ELEMENTS * sizeof(GLuint), ui->persistent_streams);
+    init_stream_buffer(&ui->instance_stream, GL_ARRAY_BUFFER, MAX_NUM_INSTANCES * sizeof(QuadInstance), ui->persistent_streams);
+    init_stream_buffer(&ui->shape_stream, GL_ARRAY_BUFFER, MAX_NUM_SHAPES * sizeof(ShapeInstance), ui->persistent_streams);
+
+    UploadStream *upload_stream = ui->upload_streams;
+#if GUI_SOA_VERTICES
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+        init_upload_stream(upload_stream++, ui->vertex_streams + attrib_##name, UploadCounter_Vertices, sizeof(type), &ui->memory);
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+#else
+    init_upload_stream(upload_stream++, ui->vertex_streams + 0, UploadCounter_Vertices, sizeof(Vertex), &ui->memory);
+#endif
+    init_upload_stream(upload_stream++, &ui->element_stream, UploadCounter_Elements, sizeof(GLuint), &ui->memory);
+    init_upload_stream(upload_stream++, &ui->instance_stream, UploadCounter_Instances, sizeof(QuadInstance), &ui->memory);
+    init_upload_stream(upload_stream++, &ui->shape_stream, UploadCounter_Shapes, sizeof(ShapeInstance), &ui->memory);
+
+    ui->retained_buffers = false;
+    ui->frame_retained = false;
+    ui->upload_segments = push_array(&ui->memory, MAX_NUM_UPLOAD_SEGMENTS, UploadSegment, no_clear());
+    ui->prev_upload_segments = push_array(&ui->memory, MAX_NUM_UPLOAD_SEGMENTS, UploadSegment, no_clear());
+
+    ui->cache_geometry = true;
+    ui->geometry_checkpoints = push_array(&ui->memory, MAX_NUM_GEOMETRY_CHECKPOINTS, GeometryCheckpoint, no_clear());
+    ui->path_commands = push_array(&ui->memory, MAX_NUM_PATH_COMMANDS, PathCommand, no_clear());
+    ui->path_cache = push_array(&ui->memory, PATH_CACHE_SIZE, FlattenedPath);
+    for (u32 memory_index = 0; memory_index < array_count(ui->geometry_memory); ++memory_index)
+    {
+        init_memory_stack(ui->geometry_memory + memory_index, 1*MB);
+        ui->geometry_frame_memory[memory_index] = begin_temp_memory(ui->geometry_memory + memory_index);
+    }
+
+    ui->quad_element_buffer = create_quad_element_buffer(&ui->memory);
+
+    ui->uniforms[uniform_proj_mat] = gl.GetUniformLocation(ui->program, "proj_mat");
+    ui->uniforms[uniform_tex]      = gl.GetUniformLocation(ui->program, "textures");
+    ui->uniforms[uniform_translation] = gl.GetUniformLocation(ui->program, "translation");
+    ui->uniforms[uniform_sdf_slot] = gl.GetUniformLocation(ui->program, "sdf_slot");
+    ui->uniforms[uniform_sdf_texture_size] = gl.GetUniformLocation(ui->program, "sdf_texture_size");
+    ui->uniforms[uniform_sdf_distance_scale] = gl.GetUniformLocation(ui->program, "sdf_distance_scale");
+    
+#if GUI_SOA_VERTICES
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+        ui->attribs[attrib_##name] = gl.GetAttribLocation(ui->program, #name); \
+        gl.BindBuffer(GL_ARRAY_BUFFER, ui->vertex_streams[attrib_##name].buffer); \
+        gl.EnableVertexAttribArray(ui->attribs[attrib_##name]); \
+        gl.VertexAttribPointer(ui->attribs[attrib_##name], num_components, gl_type, normalized, sizeof(type), 0);
+#else
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+        ui->attribs[attrib_##name] = gl.GetAttribLocation(ui->program, #name); \
+        gl.BindBuffer(GL_ARRAY_BUFFER, ui->vertex_streams[0].buffer); \
+        gl.EnableVertexAttribArray(ui->attribs[attrib_##name]); \
+        gl.VertexAttribPointer(ui->attribs[attrib_##name], num_components, gl_type, normalized, sizeof(Vertex), (void *)offset_of(Vertex, name));
+#endif
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+
+    ui->use_instancing = true;
+    ui->cpu_clipping = false;
+    ui->occlusion_culling = true;
+    ui->local_coords = false;
+    init_circle_tables(ui);
+    ui->instance_program = opengl_create_program(ui_instance_vertex_shader, ui_fragment_shader, error, sizeof(error));
+
+    ui->instance_uniforms[uniform_proj_mat] = gl.GetUniformLocation(ui->instance_program, "proj_mat");
+    ui->instance_uniforms[uniform_tex]      = gl.GetUniformLocation(ui->instance_program, "textures");
+    ui->instance_uniforms[uniform_translation] = gl.GetUniformLocation(ui->instance_program, "translation");
+    ui->instance_uniforms[uniform_sdf_slot] = gl.GetUniformLocation(ui->instance_program, "sdf_slot");
+    ui->instance_uniforms[uniform_sdf_texture_size] = gl.GetUniformLocation(ui->instance_program, "sdf_texture_size");
+    ui->instance_uniforms[uniform_sdf_distance_scale] = gl.GetUniformLocation(ui->instance_program, "sdf_distance_scale");
+
+    gl.GenVertexArrays(1, &ui->instance_vao);
+    gl.BindVertexArray(ui->instance_vao);
+
+    // NOTE(dan): the pointers are set per draw command, see draw_commands
+    #define INSTANCE_ATTRIB(name, type, num_components, gl_type, normalized) \
+        ui->instance_attribs[instance_attrib_##name] = gl.GetAttribLocation(ui->instance_program, "instance_" #name); \
+        gl.EnableVertexAttribArray(ui->instance_attribs[instance_attrib_##name]); \
+        gl.VertexAttribDivisor(ui->instance_attribs[instance_attrib_##name], 1);
+    INSTANCE_ATTRIB_LIST
+    #undef INSTANCE_ATTRIB
+
+    ui->shape_program = opengl_create_program(ui_shape_vertex_shader, ui_shape_fragment_shader, error, sizeof(error));
+    ui->shape_uniforms[uniform_proj_mat] = gl.GetUniformLocation(ui->shape_program, "proj_mat");
+    ui->shape_uniforms[uniform_translation] = gl.GetUniformLocation(ui->shape_program, "translation");
+
+    gl.GenVertexArrays(1, &ui->shape_vao);
+    gl.BindVertexArray(ui->shape_vao);
+
+    #define SHAPE_ATTRIB(name, type, num_components, gl_type, normalized) \
+        ui->shape_attribs[shape_attrib_##name] = gl.GetAttribLocation(ui->shape_program, "shape_" #name); \
+        gl.EnableVertexAttribArray(ui->shape_attribs[shape_attrib_##name]); \
+        gl.VertexAttribDivisor(ui->shape_attribs[shape_attrib_##name], 1);
+    SHAPE_ATTRIB_LIST
+    #undef SHAPE_ATTRIB
+
+    init_memory_stack(&ui->font_memory, 1*MB);
+    init_memory_stack(&ui->text_run_memory, 64*KB);
+    ui->text_run_hash = push_array(&ui->memory, TEXT_RUN_HASH_SIZE, TextRun *);
+    ui->panel_textures = push_array(&ui->memory, MAX_NUM_PANEL_TEXTURES, PanelTexture);
+    ui->current_font = push_struct(&ui->font_memory, Font);
+    ui->sdf_font = push_struct(&ui->font_memory, Font);
+    init_default_ui_texture(ui);
+    set_default_colors(ui);
+
+    Font *font = ui->current_font;
+
+    gl.GenTextures(1, &ui->texture);
+    gl.BindTexture(GL_TEXTURE_2D, ui->texture);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, font->texture_width, font->texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, font->texture_pixels);
+
+    ui->num_texture_slots = 0;
+    font->texture_slot = add_texture_slot(ui, ui->texture);
+    assert(font->texture_slot == FONT_TEXTURE_SLOT);
+
+    GlyphAtlas *atlas = ui->glyph_atlas;
+    gl.GenTextures(1, &atlas->texture);
+    gl.BindTexture(GL_TEXTURE_2D, atlas->texture);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas->pixels);
+    atlas->texture_slot = add_texture_slot(ui, atlas->texture);
+
+    Font *sdf_font = ui->sdf_font;
+    gl.GenTextures(1, &ui->sdf_texture);
+    gl.BindTexture(GL_TEXTURE_2D, ui->sdf_texture);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, sdf_font->texture_width, sdf_font->texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, sdf_font->texture_pixels);
+    sdf_font->texture_slot = add_texture_slot(ui, ui->sdf_texture);
+
+    ui->cache_textures = true;
+    ui->cache_text_runs = true;
+    ui->text_run_budget = (u32)DEFAULT_TEXT_RUN_BUDGET;
+    dllist_init(&ui->text_run_sentinel);
+    ui->idle_mode = true;
+    ui->panel_texture_budget = (u32)DEFAULT_PANEL_TEXTURE_BUDGET;
+}
+
+inline void set_sdf_uniforms(UIState *ui, GLuint *uniforms)
+{
+    Font *font = ui->sdf_font;
+    gl.Uniform1i(uniforms[uniform_sdf_slot], (GLint)font->texture_slot);
+    gl.Uniform2f(uniforms[uniform_sdf_texture_size], (f32)font->texture_width, (f32)font->texture_height);
+    gl.Uniform1f(uniforms[uniform_sdf_distance_scale], 255.0f / SDF_PIXEL_DIST_SCALE);
+}
+
+inline void bind_program(UIState *ui, GLuint program, GLuint vao)
+{
+    if (ui->bound_program != program)
+    {
+        gl.UseProgram(program);
+        gl.BindVertexArray(vao);
+        ui->bound_program = program;
+        ui->bound_translation_valid = false;
+    }
+}
+
+// NOTE(dan): scale is for fixed point vertex positions
+inline void bind_translation(UIState *ui, GLuint *uniforms, vec2 translation, f32 scale)
+{
+    if (!ui->bound_translation_valid || !vec2_equal(ui->bound_translation, translation))
+    {
+        gl.Uniform2f(uniforms[uniform_translation], scale * translation.x, scale * translation.y);
+        ui->bound_translation = translation;
+        ui->bound_translation_valid = true;
+    }
+}
+
+inline void bind_element_buffer(UIState *ui, GLuint buffer)
+{
+    if (ui->bound_element_buffer != buffer)
+    {
+        gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        ui->bound_element_buffer = buffer;
+    }
+}
+
+static void draw_commands(UIState *ui, DrawCommand *commands, u32 num_commands)
+{
+    // NOTE(dan): elements are relative to the first vertex of the region
+    GLint region_base_vertex = (GLint)(ui->stream_region_index * MAX_NUM_VERTICES);
+    usize region_element_offset = ui->stream_region_index * ui->element_stream.region_size;
+    usize region_instance_offset = ui->stream_region_index * ui->instance_stream.region_size;
+    usize region_shape_offset = ui->stream_region_index * ui->shape_stream.region_size;
+
+    for (u32 command_index = 0; command_index < num_commands; ++command_index)
+    {
+        DrawCommand *command = commands + command_index;
+        switch (command->type)
+        {
+            case DrawCommand_Quads:
+            {
+                bind_program(ui, ui->program, ui->vao);
+                bind_translation(ui, ui->uniforms, command->translation, VERTEX_POS_SCALE);
+                bind_element_buffer(ui, ui->quad_element_buffer);
+
+                u32 first_vertex = command->first;
+                u32 num_quads = command->count;
+                while (num_quads)
+                {
+                    u32 num_batch_quads = min(num_quads, MAX_NUM_QUADS_PER_BATCH);
+                    GLint base_vertex = region_base_vertex + (GLint)first_vertex;
+
+                    gl.DrawElementsBaseVertex(GL_TRIANGLES, num_batch_quads * 6, GL_UNSIGNED_SHORT, 0, base_vertex);
+                    ++ui->frame_stats->num_draw_calls;
+
+                    first_vertex += num_batch_quads * 4;
+                    num_quads -= num_batch_quads;
+                }
+            } break;
+
+            case DrawCommand_Elements:
+            {
+                bind_program(ui, ui->program, ui->vao);
+                bind_translation(ui, ui->uniforms, command->translation, VERTEX_POS_SCALE);
+                bind_element_buffer(ui, ui->element_stream.buffer);
+
+                usize element_offset = region_element_offset + command->first * sizeof(GLuint);
+                gl.DrawElementsBaseVertex(GL_TRIANGLES, command->count, GL_UNSIGNED_INT, (void *)element_offset, region_base_vertex);
+                ++ui->frame_stats->num_draw_calls;
+            } break;
+
+            case DrawCommand_Instances:
+            {
+                bind_program(ui, ui->instance_program, ui->instance_vao);
+                bind_translation(ui, ui->instance_uniforms, command->translation, 1.0f);
+
+                // NOTE(dan): there is no base instance in gl 3.3, so point the attributes at the first instance instead
+                usize instance_offset = region_instance_offset + command->first * sizeof(QuadInstance);
+                gl.BindBuffer(GL_ARRAY_BUFFER, ui->instance_stream.buffer);
+
+                #define INSTANCE_ATTRIB(name, type, num_components, gl_type, normalized) \
+                    gl.VertexAttribPointer(ui->instance_attribs[instance_attrib_##name], num_components, gl_type, normalized, \
+                                           sizeof(QuadInstance), (void *)(instance_offset + offset_of(QuadInstance, name)));
+                INSTANCE_ATTRIB_LIST
+                #undef INSTANCE_ATTRIB
+
+                gl.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, command->count);
+                ++ui->frame_stats->num_draw_calls;
+            } break;
+
+            case DrawCommand_Shapes:
+            {
+                bind_program(ui, ui->shape_program, ui->shape_vao);
+                bind_translation(ui, ui->shape_uniforms, command->translation, 1.0f);
+
+                usize shape_offset = region_shape_offset + command->first * sizeof(ShapeInstance);
+                gl.BindBuffer(GL_ARRAY_BUFFER, ui->shape_stream.buffer);
+
+                #define SHAPE_ATTRIB(name, type, num_components, gl_type, normalized) \
+                    gl.VertexAttribPointer(ui->shape_attribs[shape_attrib_##name], num_components, gl_type, normalized, \
+                                           sizeof(ShapeInstance), (void *)(shape_offset + offset_of(ShapeInstance, name)));
+                SHAPE_ATTRIB_LIST
+                #undef SHAPE_ATTRIB
+
+                gl.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, command->count);
+                ++ui->frame_stats->num_draw_calls;
+            } break;
+
+            invalid_default_case;
+        }
+    }
+}
+
+static void flush_pending_command(UIState *ui)
+{
+    if (ui->pending_command.count)
+    {
+        draw_commands(ui, &ui->pending_command, 1);
+        ui->pending_command.count = 0;
+    }
+}
+
+// NOTE(dan): merges commands that continue each other, even when they come from different panels with the same translation
+static void queue_commands(UIState *ui, DrawCommand *commands, u32 num_commands)
+{
+    for (u32 command_index = 0; command_index < num_commands; ++command_index)
+    {
+        DrawCommand *command = commands + command_index;
+        DrawCommand *pending_command = &ui->pending_command;
+
+        if (pending_command->count && is_command_followed_by(pending_command, command->type, command->first) &&
+            vec2_equal(pending_command->translation, command->translation))
+        {
+            pending_command->count += command->count;
+        }
+        else
+        {
+            flush_pending_command(ui);
+            *pending_command = *command;
+        }
+    }
+}
+
+// NOTE(dan): maps width by height pixels from origin on to the viewport, leaves the vertex program bound
+static void set_projection(UIState *ui, vec2 origin, f32 width, f32 height)
+{
+    // NOTE(dan): also scales fixed point vertex positions back to pixels
+    f32 inv_pos_scale = 1.0f / VERTEX_POS_SCALE;
+    f32 translate_x = -1.0f - 2.0f * origin.x / width;
+    f32 translate_y =  1.0f + 2.0f * origin.y / height;
+    GLfloat proj_mat[4][4] = 
+    {
+        { 2.0f * inv_pos_scale / width, 0.0f,                           0.0f, 0.0f },
+        { 0.0f,                        -2.0f * inv_pos_scale / height,  0.0f, 0.0f },
+        { 0.0f,                         0.0f,                          -1.0f, 0.0f },
+        { translate_x,                  translate_y,                    0.0f, 1.0f },
+    };
+
+    // NOTE(dan): instances and shapes are not fixed point
+    GLfloat instance_proj_mat[4][4] = 
+    {
+        { 2.0f / width, 0.0f,           0.0f, 0.0f },
+        { 0.0f,        -2.0f / height,  0.0f, 0.0f },
+        { 0.0f,         0.0f,          -1.0f, 0.0f },
+        { translate_x,  translate_y,    0.0f, 1.0f },
+    };
+
+    gl.UseProgram(ui->instance_program);
+    gl.UniformMatrix4fv(ui->instance_uniforms[uniform_proj_mat], 1, GL_FALSE, &instance_proj_mat[0][0]);
+
+    gl.UseProgram(ui->shape_program);
+    gl.UniformMatrix4fv(ui->shape_uniforms[uniform_proj_mat], 1, GL_FALSE, &instance_proj_mat[0][0]);
+
+    gl.UseProgram(ui->program);
+    gl.BindVertexArray(ui->vao);
+    gl.UniformMatrix4fv(ui->uniforms[uniform_proj_mat], 1, GL_FALSE, &proj_mat[0][0]);
+
+    ui->bound_program = ui->program;
+    ui->bound_translation_valid = false;
+}
+
+inline RenderOp *push_render_op(FramePacket *packet, RenderOpType type)
+{
+    assert(packet->num_render_ops < MAX_NUM_RENDER_OPS);
+
+    RenderOp *op = packet->render_ops + packet->num_render_ops++;
+    zero_struct(*op);
+    op->type = type;
+    return op;
+}
+
+// NOTE(dan): children begun inside of this panel own a part of its range, they are drawn with their own clip rect
+static void record_panel_commands(UIState *ui, FramePacket *packet, Panel *panel, u32 command_index, u32 end_command_index)
+{
+    while (command_index < end_command_index)
+    {
+        u32 next_command_index = end_command_index;
+        u32 num_skipped_commands = 0;
+
+        Panel *sentinel = get_panel_sentinel(panel);
+        for (Panel *child = panel->first_child; child != sentinel; child = child->next)
+        {
+            if (child->frame_index == ui->frame_index && child->num_commands &&
+                child->begin_command_index >= command_index && child->begin_command_index < next_command_index)
+            {
+                next_command_index = child->begin_command_index;
+                num_skipped_commands = child->num_commands;
+            }
+        }
+
+        if (next_command_index > command_index)
+        {
+            RenderOp *op = push_render_op(packet, RenderOp_Commands);
+            op->first = command_index;
+            op->count = next_command_index - command_index;
+        }
+        command_index = next_command_index + num_skipped_commands;
+    }
+}
+
+// NOTE(dan): occlusion is decided here and not in begin_panel, the panels above may still move after a panel was begun
+static void record_panel(UIState *ui, FramePacket *packet, Panel *panel)
+{
+    b32 begun_this_frame = (panel->frame_index == ui->frame_index);
+    panel->culled = (begun_this_frame && ui->occlusion_culling && panel->parent == ui->root_panel && 
+                     !(panel->flags & PanelFlag_Hidden) && is_panel_occluded(ui, panel));
+    if (panel->culled)
+    {
+        ++ui->num_culled_panels;
+        ui->num_culled_vertices += panel->num_vertices;
+    }
+
+    if (begun_this_frame && panel->num_commands && !(panel->flags & PanelFlag_Hidden))
+    {
+        u32 end_command_index = panel->begin_command_index + panel->num_commands;
+        b32 composited = (panel->texture && panel->composite_command_index < end_command_index);
+
+        // NOTE(dan): a culled panel still updates its texture, the signature was already taken for this frame
+        if (composited && panel->texture_dirty)
+        {
+            PanelTexture *texture = panel->texture;
+            RenderOp *op = push_render_op(packet, RenderOp_BeginPanelTexture);
+            op->texture = texture;
+            op->origin = texture->origin;
+            op->width = texture->width;
+            op->height = texture->height;
+
+            record_panel_commands(ui, packet, panel, panel->begin_command_index, panel->composite_command_index);
+            push_render_op(packet, RenderOp_EndPanelTexture);
+        }
+
+        if (!panel->culled && !packet->cpu_clipping)
+        {
+            vec2 min_pos = v2(panel->bounds.min_pos.x, packet->display_height - panel->bounds.max_pos.y);
+            RenderOp *op = push_render_op(packet, RenderOp_Scissor);
+            op->rect = r2(min_pos, vec2_add(min_pos, rect2_dim(panel->bounds)));
+        }
+
+        if (!panel->culled && composited)
+        {
+            RenderOp *op = push_render_op(packet, RenderOp_BindPanelTexture);
+            op->texture = panel->texture;
+
+            record_panel_commands(ui, packet, panel, panel->composite_command_index, end_command_index);
+            push_render_op(packet, RenderOp_UnbindPanelTexture);
+        }
+        else if (!panel->culled)
+        {
+            record_panel_commands(ui, packet, panel, panel->begin_command_index, end_command_index);
+        }
+
+        if (!panel->culled && !packet->cpu_clipping)
+        {
+            push_render_op(packet, RenderOp_Flush);
+        }
+    }
+
+    // NOTE(dan): popups are children that can reach out of a culled panel
+    if (panel_has_children(panel))
+    {
+        Panel *sentinel = get_panel_sentinel(panel);
+        for (Panel *child = panel->first_child; child != sentinel; child = child->next)
+        {
+            record_panel(ui, packet, child);
+        }
+    }
+}
+
+// NOTE(dan): takes what the renderer needs from the ui and the panels, the ui can go on with the next frame after this
+static void record_frame_packet(UIState *ui, i32 display_width, i32 display_height)
+{
+    FramePacket *packet = ui->packet;
+    packet->display_width = display_width;
+    packet->display_height = display_height;
+    packet->cpu_clipping = ui->cpu_clipping;
+    get_upload_counts(ui, packet->counts);
+    packet->num_commands = ui->num_commands;
+    packet->num_texture_slots = ui->num_texture_slots;
+    copy_memory(packet->texture_slots, ui->texture_slots, sizeof(packet->texture_slots));
+
+    GlyphAtlas *atlas = ui->glyph_atlas;
+    packet->glyph_atlas_min_y = atlas->dirty_min_y;
+    packet->glyph_atlas_max_y = atlas->dirty_max_y;
+    atlas->dirty_min_y = GLYPH_ATLAS_HEIGHT;
+    atlas->dirty_max_y = 0;
+    packet->num_render_ops = 0;
+
+    // NOTE(dan): textures of evicted or removed panels
+    for (u32 texture_index = 0; texture_index < MAX_NUM_PANEL_TEXTURES; ++texture_index)
+    {
+        PanelTexture *texture = ui->panel_textures + texture_index;
+        if (!texture->panel)
+        {
+            RenderOp *op = push_render_op(packet, RenderOp_DeletePanelTexture);
+            op->texture = texture;
+        }
+    }
+    record_panel(ui, packet, ui->root_panel);
+
+    UIStats *stats = &packet->stats;
+    stats->num_vertices = ui->num_vertices;
+    stats->num_elements = ui->num_elements;
+    stats->num_instances = ui->num_instances;
+    stats->num_shapes = ui->num_shapes;
+    stats->num_commands = ui->num_commands;
+    stats->num_culled_panels = ui->num_culled_panels;
+    stats->num_culled_vertices = ui->num_culled_vertices;
+    stats->num_cached_vertices = ui->num_cached_vertices;
+    stats->num_panel_texture_bytes = ui->num_panel_texture_bytes;
+    stats->num_text_runs = ui->num_text_runs;
+    stats->num_text_run_bytes = ui->num_text_run_bytes;
+    stats->num_atlas_glyphs_rasterized = atlas->num_glyphs_rasterized;
+    stats->num_glyph_atlas_evictions = atlas->num_evictions;
+}
+
+// NOTE(dan): the content of the panel is drawn into its texture until the end op, 
+//            the texture is not bound to its slot while it is drawn into, 
+//            the alpha is accumulated like the framebuffer would see it so the texture ends up premultiplied
+static void begin_panel_texture_pass(UIState *ui, RenderOp *op)
+{
+    PanelTexture *texture = op->texture;
+    flush_pending_command(ui);
+
+    gl.ActiveTexture(GL_TEXTURE0 + PANEL_TEXTURE_SLOT);
+    if (!texture->texture)
+    {
+        gl.GenTextures(1, &texture->texture);
+        gl.GenFramebuffers(1, &texture->framebuffer);
+
+        gl.BindTexture(GL_TEXTURE_2D, texture->texture);
+        gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    if (texture->texture_width != op->width || texture->texture_height != op->height)
+    {
+        gl.BindTexture(GL_TEXTURE_2D, texture->texture);
+        gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, op->width, op->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        texture->texture_width = op->width;
+        texture->texture_height = op->height;
+    }
+    gl.BindTexture(GL_TEXTURE_2D, 0);
+    gl.ActiveTexture(GL_TEXTURE0);
+
+    gl.BindFramebuffer(GL_FRAMEBUFFER, texture->framebuffer);
+    gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->texture, 0);
+    gl.Viewport(0, 0, op->width, op->height);
+    gl.Scissor(0, 0, op->width, op->height);
+    gl.ClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    gl.Clear(GL_COLOR_BUFFER_BIT);
+    gl.BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    set_projection(ui, op->origin, (f32)op->width, (f32)op->height);
+}
+
+static void end_panel_texture_pass(UIState *ui, FramePacket *packet)
+{
+    flush_pending_command(ui);
+
+    gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.Viewport(0, 0, packet->display_width, packet->display_height);
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    set_projection(ui, v2(0.0f, 0.0f), (f32)packet->display_width, (f32)packet->display_height);
+}
+
+static void draw_render_ops(UIState *ui, FramePacket *packet)
+{
+    for (u32 op_index = 0; op_index < packet->num_render_ops; ++op_index)
+    {
+        RenderOp *op = packet->render_ops + op_index;
+        switch (op->type)
+        {
+            case RenderOp_Commands:
+            {
+                queue_commands(ui, packet->commands + op->first, op->count);
+            } break;
+
+            case RenderOp_Flush:
+            {
+                flush_pending_command(ui);
+            } break;
+
+            case RenderOp_Scissor:
+            {
+                vec2 dim = rect2_dim(op->rect);
+                gl.Scissor((GLint)op->rect.min_pos.x, (GLint)op->rect.min_pos.y, (GLsizei)dim.x, (GLsizei)dim.y);
+            } break;
+
+            case RenderOp_BeginPanelTexture:
+            {
+                begin_panel_texture_pass(ui, op);
+            } break;
+
+            case RenderOp_EndPanelTexture:
+            {
+                end_panel_texture_pass(ui, packet);
+            } break;
+
+            case RenderOp_BindPanelTexture:
+            {
+                // NOTE(dan): commands of other panels might still sample the slot, the texture is premultiplied
+                flush_pending_command(ui);
+                gl.ActiveTexture(GL_TEXTURE0 + PANEL_TEXTURE_SLOT);
+                gl.BindTexture(GL_TEXTURE_2D, op->texture->texture);
+                gl.ActiveTexture(GL_TEXTURE0);
+                gl.BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+                ++ui->frame_stats->num_panel_textures_drawn;
+            } break;
+
+            case RenderOp_UnbindPanelTexture:
+            {
+                flush_pending_command(ui);
+                gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            } break;
+
+            case RenderOp_DeletePanelTexture:
+            {
+                PanelTexture *texture = op->texture;
+                if (texture->texture)
+                {
+                    gl.DeleteFramebuffers(1, &texture->framebuffer);
+                    gl.DeleteTextures(1, &texture->texture);
+                    texture->framebuffer = 0;
+                    texture->texture = 0;
+                    texture->texture_width = 0;
+                    texture->texture_height = 0;
+                }
+            } break;
+
+            invalid_default_case;
+        }
+    }
+}
+
+// NOTE(dan): only touches the gl side of the ui, in pipelined mode this runs on the render thread
+static void draw_frame_packet(UIState *ui, FramePacket *packet)
+{
+    i32 display_width = packet->display_width;
+    i32 display_height = packet->display_height;
 
-struct AppState
+    // NOTE(dan): slot i samples texture unit i
+    GLint texture_units[MAX_NUM_TEXTURE_SLOTS];
+    for (u32 slot = 0; slot < MAX_NUM_TEXTURE_SLOTS; ++slot)
+    {
+        texture_units[slot] = (GLint)slot;
+    }
+
+    gl.Viewport(0, 0, display_width, display_height);
+    gl.ClearColor(14.0f / 255.0f, 28.0f / 255.0f, 42.0f / 255.0f, 1.0f);
+    gl.Clear(GL_COLOR_BUFFER_BIT);
+
+    gl.UseProgram(ui->instance_program);
+    gl.Uniform1iv(ui->instance_uniforms[uniform_tex], MAX_NUM_TEXTURE_SLOTS, texture_units);
+    set_sdf_uniforms(ui, ui->instance_uniforms);
+
+    set_projection(ui, v2(0.0f, 0.0f), (f32)display_width, (f32)display_height);
+    gl.Uniform1iv(ui->uniforms[uniform_tex], MAX_NUM_TEXTURE_SLOTS, texture_units);
+    set_sdf_uniforms(ui, ui->uniforms);
+    gl.Enable(GL_BLEND);
+    gl.BlendEquation(GL_FUNC_ADD);
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.Disable(GL_CULL_FACE);
+    gl.Disable(GL_DEPTH_TEST);
+
+    for (u32 slot = 0; slot < packet->num_texture_slots; ++slot)
+    {
+        gl.ActiveTexture(GL_TEXTURE0 + slot);
+        gl.BindTexture(GL_TEXTURE_2D, packet->texture_slots[slot]);
+    }
+
+    // NOTE(dan): the ui thread keeps rasterizing and evicting while this uploads, the dirty rows can share a band with 
+    //            those, TexSubImage2D copies the pixels before it returns so the mutex is only held for the copy
+    if (packet->glyph_atlas_max_y > packet->glyph_atlas_min_y)
+    {
+        GlyphAtlas *atlas = ui->glyph_atlas;
+        gl.ActiveTexture(GL_TEXTURE0 + atlas->texture_slot);
+
+        begin_mutex(&atlas->mutex);
+        gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, packet->glyph_atlas_min_y, GLYPH_ATLAS_WIDTH, packet->glyph_atlas_max_y - packet->glyph_atlas_min_y,
+                         GL_RGBA, GL_UNSIGNED_BYTE, atlas->pixels + packet->glyph_atlas_min_y * GLYPH_ATLAS_WIDTH);
+        end_mutex(&atlas->mutex);
+    }
+    gl.ActiveTexture(GL_TEXTURE0);
+
+    u32 num_bytes_uploaded = 0;
+    if (packet->streams[0])
+    {
+        wait_for_stream_region(ui);
+        for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+        {
+            UploadStream *upload_stream = ui->upload_streams + stream_index;
+            u32 size = packet->counts[upload_stream->counter] * upload_stream->element_size;
+
+            void *region = map_stream_region(upload_stream->stream, ui->stream_region_index);
+            copy_memory(region, packet->streams[stream_index], size);
+            unmap_stream_region(upload_stream->stream);
+            num_bytes_uploaded += size;
+        }
+    }
+    else if (ui->frame_retained)
+    {
+        num_bytes_uploaded = upload_dirty_segments(ui);
+    }
+    else
+    {
+        for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+        {
+            UploadStream *upload_stream = ui->upload_streams + stream_index;
+
+            unmap_stream_region(upload_stream->stream);
+            num_bytes_uploaded += packet->counts[upload_stream->counter] * upload_stream->element_size;
+        }
+    }
+
+    // NOTE(dan): the element buffer binding is part of the vao, rebind it on the first command
+    ui->bound_program = ui->program;
+    ui->bound_translation_valid = false;
+    ui->bound_element_buffer = 0;
+    ui->pending_command.count = 0;
+
+    UIStats *stats = &packet->stats;
+    ui->frame_stats = stats;
+    stats->num_draw_calls = 0;
+    stats->num_bytes_uploaded = num_bytes_uploaded;
+    stats->num_panel_textures_drawn = 0;
+
+    if (packet->cpu_clipping)
+    {
+        draw_render_ops(ui, packet);
+        flush_pending_command(ui);
+    }
+    else
+    {
+        gl.Enable(GL_SCISSOR_TEST);
+        draw_render_ops(ui, packet);
+        gl.Disable(GL_SCISSOR_TEST);
+    }
+
+    end_stream_region(ui);
+}
+
+static void clear_frame(UIState *ui)
 {
-    MemoryStack app_memory;
+    ui->num_elements = 0;
+    ui->num_vertices = 0;
+    ui->num_instances = 0;
+    ui->num_shapes = 0;
+    ui->num_commands = 0;
+    ui->command_barrier = 0;
+    ui->num_culled_panels = 0;
+    ui->num_culled_vertices = 0;
+    ui->num_cached_vertices = 0;
+    ui->panel_textures_dirty = false;
+}
 
-    UIState ui_state;
-};
+static void render_ui(UIState *ui, i32 display_width, i32 display_height)
+{
+    record_frame_packet(ui, display_width, display_height);
+    draw_frame_packet(ui, ui->packet);
+    ui->stats = ui->packet->stats;
+    clear_frame(ui);
+}
 
-static void opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar *message, GLvoid *user_param)
+// NOTE(dan): system memory for a whole region of every stream, followed by extra_size bytes, which are returned
+static u8 *allocate_stream_memory(UIState *ui, u8 **streams, usize extra_size)
 {
-    if (severity == GL_DEBUG_SEVERITY_HIGH)
+    usize size = extra_size;
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
     {
-        char *error = (char *)message;
-        assert(!error);
+        size += ui->upload_streams[stream_index].stream->region_size;
+    }
+
+    u8 *at = (u8 *)platform.virtual_alloc(size);
+    assert(at);
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        streams[stream_index] = at;
+        at += ui->upload_streams[stream_index].stream->region_size;
     }
+    return at;
 }
 
-static void init_ui(UIState *ui, PlatformInput *input)
+// NOTE(dan): pipelined frames are built into the next packet of the ring, the platform makes sure the render thread 
+//            is done with it, other frames are built into the next region of the stream buffers
+static void begin_frame(UIState *ui)
 {
-    ui->input = input;
+    // NOTE(dan): the render thread is done with every packet before num_packets_read, when the ring is full the last one 
+    //            it drew is the one built next, its stats are only overwritten when it is recorded so they are read first
+    u32 num_packets_read = ui->num_packets_read;
+    compiler_barrier();
+    if (num_packets_read != ui->num_stats_packets_read)
+    {
+        ui->stats = ui->frame_packets[(num_packets_read - 1) % NUM_FRAME_PACKETS].stats;
+        ui->num_stats_packets_read = num_packets_read;
+    }
 
-    ui->num_vertices = 0;
-    ui->num_elements = 0;
-    ui->vertices = push_array(&ui->memory, MAX_NUM_VERTICES, Vertex);
-    ui->elements = push_array(&ui->memory, MAX_NUM_ELEMENTS, GLuint);
+    ui->frame_pipelined = ui->pipelined;
+    if (ui->frame_pipelined)
+    {
+        assert(ui->num_packets_written - ui->num_packets_read < NUM_FRAME_PACKETS);
 
-    ui->root_panel = create_panel(ui, "Root Panel");
+        FramePacket *packet = ui->frame_packets + (ui->num_packets_written % NUM_FRAME_PACKETS);
+        if (!packet->commands)
+        {
+            u8 *at = allocate_stream_memory(ui, packet->streams, MAX_NUM_DRAW_COMMANDS * sizeof(DrawCommand) + MAX_NUM_RENDER_OPS * sizeof(RenderOp));
+            packet->commands = (DrawCommand *)at;
+            packet->render_ops = (RenderOp *)(at + MAX_NUM_DRAW_COMMANDS * sizeof(DrawCommand));
+        }
 
-    char error[1024];
-    ui->program = opengl_create_program(ui_vertex_shader, ui_fragment_shader, error, sizeof(error));
+        ui->packet = packet;
+        ui->frame_retained = false;
+        ui->presented = false;
+        set_stream_pointers(ui, packet->streams);
+    }
+    else
+    {
+        ui->packet = &ui->immediate_packet;
+        begin_stream_region(ui);
+    }
+    ui->commands = ui->packet->commands;
+}
 
-    gl.GenVertexArrays(1, &ui->vao);
-    gl.BindVertexArray(ui->vao);
+static void queue_frame_packet(UIState *ui, i32 display_width, i32 display_height)
+{
+    record_frame_packet(ui, display_width, display_height);
 
-    gl.GenBuffers(1, &ui->vbo);
-    gl.BindBuffer(GL_ARRAY_BUFFER, ui->vbo);
-    
-    gl.GenBuffers(1, &ui->ebo);
-    gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ui->ebo);
+    // NOTE(dan): the packet has to be written before the render thread can see it
+    compiler_barrier();
+    ui->num_packets_written = ui->num_packets_written + 1;
+    clear_frame(ui);
+}
 
-    ui->uniforms[uniform_proj_mat] = gl.GetUniformLocation(ui->program, "proj_mat");
-    ui->uniforms[uniform_tex]      = gl.GetUniformLocation(ui->program, "tex");
-    
-    ui->attribs[attrib_pos]   = gl.GetAttribLocation(ui->program, "pos");
-    ui->attribs[attrib_uv]    = gl.GetAttribLocation(ui->program, "uv");
-    ui->attribs[attrib_color] = gl.GetAttribLocation(ui->program, "color");
+static RENDER_FRAME(render_frame)
+{
+    UIState *ui = &memory->app_state->ui_state;
+    assert(ui->num_packets_read != ui->num_packets_written);
 
-    gl.EnableVertexAttribArray(ui->attribs[attrib_pos]);
-    gl.EnableVertexAttribArray(ui->attribs[attrib_uv]);
-    gl.EnableVertexAttribArray(ui->attribs[attrib_color]);
+    FramePacket *packet = ui->frame_packets + (ui->num_packets_read % NUM_FRAME_PACKETS);
+    draw_frame_packet(ui, packet);
 
-    gl.VertexAttribPointer(ui->attribs[attrib_pos],   2, GL_FLOAT,         GL_FALSE, sizeof(Vertex), (void *)offset_of(Vertex, pos));
-    gl.VertexAttribPointer(ui->attribs[attrib_uv],    2, GL_FLOAT,         GL_FALSE, sizeof(Vertex), (void *)offset_of(Vertex, uv));
-    gl.VertexAttribPointer(ui->attribs[attrib_color], 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(Vertex), (void *)offset_of(Vertex, color));
+    compiler_barrier();
+    ui->num_packets_read = ui->num_packets_read + 1;
+}
 
-    init_memory_stack(&ui->font_memory, 1*MB);
-    init_default_ui_texture(ui);
-    set_default_colors(ui);
+static PLATFORM_WORK_QUEUE_CALLBACK(do_panel_job)
+{
+    PanelJob *job = (PanelJob *)data;
+    job->callback(&job->ui, job->data);
+}
 
-    Font *font = &ui->current_font;
+// NOTE(dan): the callback builds the rest of the current panel, on a worker thread when there are any, it can draw and 
+//            lay out like on the main thread but must not begin panels, a widget that was clicked can only tell it 
+//            through data, what the widgets changed of the panel and the frames they asked for are merged back, 
+//            nothing of a panel with jobs is cached, see complete_panel_jobs
+static void queue_panel_job(UIState *ui, PanelJobCallback *callback, void *data)
+{
+    Panel *panel = ui->current_panel;
+    assert(panel && panel != ui->root_panel);
+    assert(ui->num_panel_jobs < MAX_NUM_PANEL_JOBS);
 
-    gl.GenTextures(1, &ui->texture);
-    gl.BindTexture(GL_TEXTURE_2D, ui->texture);
-    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, font->texture_width, font->texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, font->texture_pixels);
+    break_panel_geometry(ui, panel);
+    panel->cache_texture = false;
+
+    u32 job_index = ui->num_panel_jobs++;
+    PanelJob *job = ui->panel_jobs + job_index;
+    if (!job->commands)
+    {
+        // NOTE(dan): the streams start small and grow with what the job emits, see reserve_stream_room
+        for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+        {
+            UploadStream *upload_stream = ui->upload_streams + stream_index;
+            u32 capacity = max_upload_counts[upload_stream->counter] >> JOB_STREAM_CAPACITY_SHIFT;
+            job->stream_capacities[upload_stream->counter] = capacity;
+            job->streams[stream_index] = (u8 *)platform.virtual_alloc(capacity * upload_stream->element_size);
+            assert(job->streams[stream_index]);
+        }
+
+        init_memory_stack(&job->memory, 64*KB);
+        init_memory_stack(&job->path_memory, 64*KB);
+        job->commands = push_array(&job->memory, MAX_NUM_DRAW_COMMANDS, DrawCommand, no_clear());
+        job->path_commands = push_array(&job->memory, MAX_NUM_PATH_COMMANDS, PathCommand, no_clear());
+        job->path_cache = push_array(&job->memory, PATH_CACHE_SIZE, FlattenedPath, no_clear());
+    }
+
+    job->callback = callback;
+    job->data = data;
+    job->owner = panel;
+    job->panel = *panel;
+    job->panel.replay_geometry = false;
+    job->panel.record_geometry = false;
+
+    // NOTE(dan): everything the ui keeps for the main thread only is behind pointers, the copy is only its settings, 
+    //            the frame state and the fonts and tables it shares read only
+    UIState *job_ui = &job->ui;
+    *job_ui = *ui;
+    job_ui->job = job;
+    job_ui->current_panel = &job->panel;
+    job_ui->active_panel = (ui->active_panel == panel) ? &job->panel : ui->active_panel;
+    job_ui->cache_geometry = false;
+    job_ui->cache_textures = false;
+    job_ui->cache_text_runs = false;
+    job_ui->frame_retained = false;
+    job_ui->work_queue = 0;
+    job_ui->num_panel_jobs = 0;
+    job_ui->panel_jobs = 0;
+
+    // NOTE(dan): flattened paths only live for the frame
+    u32 memory_index = ui->geometry_memory_index;
+    job_ui->memory = job->memory;
+    job_ui->geometry_memory[memory_index] = job->path_memory;
+    zero_struct(job_ui->geometry_memory[!memory_index]);
+    job->path_frame_memory = begin_temp_memory(job_ui->geometry_memory + memory_index);
+    job_ui->path_cache = job->path_cache;
+    zero_size(job_ui->path_cache, PATH_CACHE_SIZE * sizeof(FlattenedPath));
+    job_ui->path_commands = job->path_commands;
+    job_ui->num_path_commands = 0;
+
+    set_stream_pointers(job_ui, job->streams);
+    job_ui->commands = job->commands;
+    job_ui->num_vertices = 0;
+    job_ui->num_elements = 0;
+    job_ui->num_instances = 0;
+    job_ui->num_shapes = 0;
+    job_ui->num_commands = 0;
+    job_ui->command_barrier = 0;
+
+    // NOTE(dan): nothing after the placeholder is merged into the commands before it
+    assert(ui->num_commands < MAX_NUM_DRAW_COMMANDS);
+    DrawCommand *command = ui->commands + ui->num_commands++;
+    command->type = DrawCommand_Job;
+    command->first = job_index;
+    command->count = 0;
+    command->translation = ui->draw_origin;
+    ui->command_barrier = ui->num_commands;
+
+    if (ui->work_queue)
+    {
+        platform.add_work(ui->work_queue, do_panel_job, job);
+    }
+    else
+    {
+        do_panel_job(0, job);
+    }
 }
 
-static void draw_panel(Panel *panel, u32 display_width, u32 display_height)
+static void remap_panel_commands(UIState *ui, Panel *panel, u32 *new_command_indices)
 {
-    if (panel->num_elements && !(panel->flags & PanelFlag_Hidden))
+    if (panel->frame_index == ui->frame_index)
     {
-        vec2 min_pos = v2(panel->bounds.min_pos.x, display_height - panel->bounds.max_pos.y);
-        vec2 dim = rect2_dim(panel->bounds);
-        u32 element_index = panel->begin_element_index * sizeof(u32);
+        u32 end_command_index = new_command_indices[panel->begin_command_index + panel->num_commands];
+        panel->begin_command_index = new_command_indices[panel->begin_command_index];
+        panel->num_commands = end_command_index - panel->begin_command_index;
+        panel->composite_command_index = new_command_indices[panel->composite_command_index];
+    }
 
-        gl.Scissor((GLint)min_pos.x, (GLint)min_pos.y, (GLsizei)dim.x, (GLsizei)dim.y);
-        gl.DrawElements(GL_TRIANGLES, panel->num_elements, GL_UNSIGNED_INT, (void *)element_index);
+    Panel *sentinel = get_panel_sentinel(panel);
+    for (Panel *child = panel->first_child; child != sentinel; child = child->next)
+    {
+        remap_panel_commands(ui, child, new_command_indices);
     }
+}
 
-    if (panel_has_children(panel))
+// NOTE(dan): appends what the jobs emitted to the streams in the order they were queued and splices their commands in 
+//            place of their placeholders, so they are drawn in the z-order of their panels
+static void complete_panel_jobs(UIState *ui)
+{
+    if (ui->num_panel_jobs)
     {
-        Panel *sentinel = get_panel_sentinel(panel);
-        for (Panel *child = panel->first_child; child != sentinel; child = child->next)
+        if (ui->work_queue)
+        {
+            platform.complete_all_work(ui->work_queue);
+        }
+        close_upload_segment(ui);
+
+        for (u32 job_index = 0; job_index < ui->num_panel_jobs; ++job_index)
+        {
+            PanelJob *job = ui->panel_jobs + job_index;
+            UIState *job_ui = &job->ui;
+
+            u32 counts[UploadCounter_Count];
+            u32 job_counts[UploadCounter_Count];
+            get_upload_counts(ui, counts);
+            get_upload_counts(job_ui, job_counts);
+
+            assert(counts[UploadCounter_Vertices] + job_counts[UploadCounter_Vertices] <= MAX_NUM_VERTICES);
+            assert(counts[UploadCounter_Elements] + job_counts[UploadCounter_Elements] <= MAX_NUM_ELEMENTS);
+            assert(counts[UploadCounter_Instances] + job_counts[UploadCounter_Instances] <= MAX_NUM_INSTANCES);
+            assert(counts[UploadCounter_Shapes] + job_counts[UploadCounter_Shapes] <= MAX_NUM_SHAPES);
+
+            for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+            {
+                UploadStream *upload_stream = ui->upload_streams + stream_index;
+                u32 counter = upload_stream->counter;
+                u8 *dest = upload_stream->base + counts[counter] * upload_stream->element_size;
+
+                if (counter == UploadCounter_Elements)
+                {
+                    GLuint *source_elements = (GLuint *)job->streams[stream_index];
+                    GLuint *elements = (GLuint *)dest;
+                    for (u32 element_index = 0; element_index < job_counts[counter]; ++element_index)
+                    {
+                        elements[element_index] = source_elements[element_index] + counts[UploadCounter_Vertices];
+                    }
+                }
+                else
+                {
+                    copy_memory(dest, job->streams[stream_index], job_counts[counter] * upload_stream->element_size);
+                }
+            }
+
+            for (u32 command_index = 0; command_index < job_ui->num_commands; ++command_index)
+            {
+                DrawCommand *command = job->commands + command_index;
+                command->first += counts[get_command_counter(command->type)];
+            }
+
+            ui->num_vertices += job_counts[UploadCounter_Vertices];
+            ui->num_elements += job_counts[UploadCounter_Elements];
+            ui->num_instances += job_counts[UploadCounter_Instances];
+            ui->num_shapes += job_counts[UploadCounter_Shapes];
+            close_upload_segment(ui);
+
+            // NOTE(dan): for panels that size themselves to their content next frame
+            Panel *owner = job->owner;
+            owner->layout_at = job->panel.layout_at;
+            owner->layout_max = job->panel.layout_max;
+            owner->current_line_height = job->panel.current_line_height;
+
+            // NOTE(dan): widgets have no ids, hover and clicks are read from the input in the job itself, what is left of 
+            //            the interaction is a menu button hiding its panel and the frames asked for by animations
+            owner->flags = job->panel.flags;
+            ui->frame_requested = (ui->frame_requested || job_ui->frame_requested);
+            if (job_ui->wakeup_seconds > 0.0f)
+            {
+                request_frame(ui, job_ui->wakeup_seconds);
+            }
+            owner->num_vertices += get_num_emitted_vertices(job_ui);
+
+            end_temp_memory(job->path_frame_memory);
+            job->memory = job_ui->memory;
+            job->path_memory = job_ui->geometry_memory[ui->geometry_memory_index];
+        }
+
+        TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
         {
-            draw_panel(child, display_width, display_height);
+            u32 num_commands = ui->num_commands;
+            DrawCommand *commands = push_array(&ui->memory, num_commands, DrawCommand, no_clear());
+            u32 *new_command_indices = push_array(&ui->memory, num_commands + 1, u32, no_clear());
+            copy_memory(commands, ui->commands, num_commands * sizeof(DrawCommand));
+
+            ui->num_commands = 0;
+            for (u32 command_index = 0; command_index < num_commands; ++command_index)
+            {
+                DrawCommand *command = commands + command_index;
+                new_command_indices[command_index] = ui->num_commands;
+
+                if (command->type == DrawCommand_Job)
+                {
+                    PanelJob *job = ui->panel_jobs + command->first;
+                    u32 num_job_commands = job->ui.num_commands;
+                    assert(ui->num_commands + num_job_commands <= MAX_NUM_DRAW_COMMANDS);
+
+                    copy_memory(ui->commands + ui->num_commands, job->commands, num_job_commands * sizeof(DrawCommand));
+                    ui->num_commands += num_job_commands;
+                }
+                else
+                {
+                    ui->commands[ui->num_commands++] = *command;
+                }
+            }
+            new_command_indices[num_commands] = ui->num_commands;
+            ui->command_barrier = ui->num_commands;
+
+            remap_panel_commands(ui, ui->root_panel, new_command_indices);
         }
+        end_temp_memory(temp_memory);
+
+        ui->num_panel_jobs = 0;
     }
 }
 
-static void render_ui(UIState *ui, i32 display_width, i32 display_height)
+// NOTE(dan): the retained streams know which segments changed, streamed ones would have to be read back from the gpu mapping
+static b32 is_frame_presented(UIState *ui, i32 display_width, i32 display_height)
 {
-    GLfloat proj_mat[4][4] = 
+    u64 hash = hash_words(FNV_HASH_SEED, ui->commands, ui->num_commands * sizeof(DrawCommand));
+    hash = hash_words(hash, ui->texture_slots, sizeof(ui->texture_slots));
+    hash = hash_words(hash, &display_width, sizeof(display_width));
+    hash = hash_words(hash, &display_height, sizeof(display_height));
+
+    b32 glyph_atlas_dirty = (ui->glyph_atlas->dirty_max_y > ui->glyph_atlas->dirty_min_y);
+    b32 presented = (ui->frame_retained && ui->presented && ui->presented_hash == hash && !ui->panel_textures_dirty && !glyph_atlas_dirty);
+    if (presented)
     {
-        { 2.0f / display_width, 0.0f,                  0.0f, 0.0f },
-        { 0.0f,                -2.0f / display_height, 0.0f, 0.0f },
-        { 0.0f,                 0.0f,                 -1.0f, 0.0f },
-        {-1.0f,                 1.0f,                  0.0f, 1.0f },
-    };
+        close_upload_segment(ui);
 
-    gl.Viewport(0, 0, display_width, display_height);
-    gl.UseProgram(ui->program);
-    gl.BindVertexArray(ui->vao);
-    gl.Uniform1i(ui->uniforms[uniform_tex], 0);
-    gl.UniformMatrix4fv(ui->uniforms[uniform_proj_mat], 1, GL_FALSE, &proj_mat[0][0]);
-    gl.Enable(GL_BLEND);
-    gl.BlendEquation(GL_FUNC_ADD);
-    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    gl.Disable(GL_CULL_FACE);
-    gl.Disable(GL_DEPTH_TEST);
+        presented = (ui->num_upload_segments == ui->num_prev_upload_segments);
+        for (u32 segment_index = 0; presented && segment_index < ui->num_upload_segments; ++segment_index)
+        {
+            presented = is_upload_segment_clean(ui, segment_index);
+        }
+    }
 
-    gl.ActiveTexture(GL_TEXTURE0);
-    gl.BindTexture(GL_TEXTURE_2D, ui->texture);
+    ui->presented_hash = hash;
+    ui->presented = true;
+    return presented;
+}
+
+// NOTE(dan): the streams stay in their region, the frame is written over by the next one
+static void skip_frame(UIState *ui)
+{
+    ui->num_upload_segments = 0;
+    for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+    {
+        ui->upload_segment_begin[counter] = 0;
+    }
+    clear_frame(ui);
+}
 
-    gl.BindBuffer(GL_ARRAY_BUFFER, ui->vbo);
-    gl.BufferData(GL_ARRAY_BUFFER, ui->num_vertices * sizeof(Vertex), ui->vertices, GL_STREAM_DRAW);
+// NOTE(dan): build.bat pairs INTERNAL_BUILD with -Od, timings of an unoptimized build say nothing about the layouts
+#if INTERNAL_BUILD
+    #define VERTEX_STREAMS_BENCHMARK_BUILD " (debug build)"
+#else
+    #define VERTEX_STREAMS_BENCHMARK_BUILD ""
+#endif
+
+struct VertexStreamsBenchmark
+{
+    f32 aos_cycles_per_quad;
+    f32 soa_cycles_per_quad;
+};
 
-    gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ui->ebo);
-    gl.BufferData(GL_ELEMENT_ARRAY_BUFFER, ui->num_elements * sizeof(GLuint), ui->elements, GL_STREAM_DRAW);
+static VertexStreamsBenchmark benchmark_vertex_streams(MemoryStack *memory)
+{
+    VertexStreamsBenchmark result = {};
 
-    gl.Enable(GL_SCISSOR_TEST);
-    draw_panel(ui->root_panel, display_width, display_height);
-    gl.Disable(GL_SCISSOR_TEST);
+    // NOTE(dan): a full stream of quads, 8 times
+    u32 num_runs = 8;
+    u32 num_quads = MAX_NUM_VERTICES / 4;
+    u32 color = 0xFF808080;
+    vec2 min_uv = v2(0.25f, 0.25f);
+    vec2 max_uv = v2(0.75f, 0.75f);
 
-    ui->num_elements = 0;
-    ui->num_vertices = 0;
+    TempMemoryStack temp_memory = begin_temp_memory(memory);
+    {
+        AosVertexStreams aos_streams;
+        aos_streams.vertices = push_array(memory, MAX_NUM_VERTICES, Vertex, no_clear());
+
+        SoaVertexStreams soa_streams;
+        #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+            soa_streams.name = push_array(memory, MAX_NUM_VERTICES, type, no_clear());
+        VERTEX_ATTRIB_LIST
+        #undef VERTEX_ATTRIB
+
+        u64 aos_cycles = 0;
+        u64 soa_cycles = 0;
+
+        // NOTE(dan): same quads as add_textured_quad writes them, into memory that is not mapped to the gpu
+        for (u32 run_index = 0; run_index < num_runs; ++run_index)
+        {
+            u64 start_cycles = __rdtsc();
+            for (u32 quad_index = 0; quad_index < num_quads; ++quad_index)
+            {
+                vec2 min_pos = v2((f32)(quad_index % 64) * 8.0f, (f32)(quad_index / 64) * 8.0f);
+                vec2 max_pos = vec2_add(min_pos, v2(8.0f, 8.0f));
+                set_quad(&aos_streams, quad_index * 4, min_pos, max_pos, min_uv, max_uv, color, color, color, color);
+            }
+            aos_cycles += __rdtsc() - start_cycles;
+
+            start_cycles = __rdtsc();
+            for (u32 quad_index = 0; quad_index < num_quads; ++quad_index)
+            {
+                vec2 min_pos = v2((f32)(quad_index % 64) * 8.0f, (f32)(quad_index / 64) * 8.0f);
+                vec2 max_pos = vec2_add(min_pos, v2(8.0f, 8.0f));
+                set_quad(&soa_streams, quad_index * 4, min_pos, max_pos, min_uv, max_uv, color, color, color, color);
+            }
+            soa_cycles += __rdtsc() - start_cycles;
+        }
+
+        f32 total_num_quads = (f32)num_runs * (f32)num_quads;
+        result.aos_cycles_per_quad = (f32)aos_cycles / total_num_quads;
+        result.soa_cycles_per_quad = (f32)soa_cycles / total_num_quads;
+    }
+    end_temp_memory(temp_memory);
+    return result;
 }
 
 inline void change_unit_and_size(char **unit, usize *size)
@@ -224,17 +1585,24 @@ static UPDATE_AND_RENDER(update_and_render)
             gl.DebugMessageCallback(opengl_debug_callback, 0);
         }
 
-        init_ui(&app_state->ui_state, input);
+        init_ui(&app_state->ui_state, input, memory->work_queue);
     }
 
-    gl.ClearColor(14.0f / 255.0f, 28.0f / 255.0f, 42.0f / 255.0f, 1.0f);
-    gl.Clear(GL_COLOR_BUFFER_BIT);
-
     UIState *ui = &app_state->ui_state;
+
+    // NOTE(dan): runs before the frame is built, once at startup and again when the view menu asks for it, so it never 
+    //            stalls a panel halfway through
+    static VertexStreamsBenchmark vertex_streams_benchmark = {};
+    static b32 vertex_streams_benchmark_requested = true;
+    if (vertex_streams_benchmark_requested)
+    {
+        vertex_streams_benchmark = benchmark_vertex_streams(&ui->memory);
+        vertex_streams_benchmark_requested = false;
+    }
+
+    begin_frame(ui);
     begin_ui(ui, window_width, window_height);
     {
-        static u32 last_frame_num_vertices = 0;
-        static u32 last_frame_num_elements = 0;
 
         // NOTE(dan): menu bar
         begin_menu_bar(ui);
@@ -250,6 +1618,55 @@ static UPDATE_AND_RENDER(update_and_render)
 
             if (begin_menu(ui, "View"))
             {
+                if (menu_button(ui, "Benchmark vertex streams"))
+                {
+                    vertex_streams_benchmark_requested = true;
+                    request_frame(ui);
+                }
+                if (menu_button(ui, ui->use_instancing ? "Disable instancing" : "Enable instancing"))
+                {
+                    ui->use_instancing = !ui->use_instancing;
+                }
+                if (menu_button(ui, ui->cpu_clipping ? "Disable cpu clipping" : "Enable cpu clipping"))
+                {
+                    ui->cpu_clipping = !ui->cpu_clipping;
+                }
+                if (menu_button(ui, ui->occlusion_culling ? "Disable occlusion culling" : "Enable occlusion culling"))
+                {
+                    ui->occlusion_culling = !ui->occlusion_culling;
+                }
+                if (menu_button(ui, ui->retained_buffers ? "Disable retained buffers" : "Enable retained buffers"))
+                {
+                    ui->retained_buffers = !ui->retained_buffers;
+                }
+                if (menu_button(ui, ui->local_coords ? "Disable local coordinates" : "Enable local coordinates"))
+                {
+                    ui->local_coords = !ui->local_coords;
+                }
+                if (menu_button(ui, ui->cache_geometry ? "Disable geometry cache" : "Enable geometry cache"))
+                {
+                    ui->cache_geometry = !ui->cache_geometry;
+                }
+                if (menu_button(ui, ui->cache_textures ? "Disable panel textures" : "Enable panel textures"))
+                {
+                    ui->cache_textures = !ui->cache_textures;
+                }
+                if (menu_button(ui, ui->sdf_text ? "Disable sdf text" : "Enable sdf text (no cjk or hangul)"))
+                {
+                    ui->sdf_text = !ui->sdf_text;
+                }
+                if (menu_button(ui, ui->cache_text_runs ? "Disable text run cache" : "Enable text run cache"))
+                {
+                    ui->cache_text_runs = !ui->cache_text_runs;
+                }
+                if (menu_button(ui, ui->idle_mode ? "Disable idle mode" : "Enable idle mode"))
+                {
+                    ui->idle_mode = !ui->idle_mode;
+                }
+                if (menu_button(ui, ui->pipelined ? "Disable pipelined frames" : "Enable pipelined frames"))
+                {
+                    ui->pipelined = !ui->pipelined;
+                }
                 if (menu_button(ui, "Test 1"))
                 {
                 }
@@ -283,7 +1700,32 @@ static UPDATE_AND_RENDER(update_and_render)
 
                 textf_out(ui, "Frame time: %.3fs", input->dt);
                 newline(ui);
-                textf_out(ui, "Vertices: %d Elements: %d", last_frame_num_vertices, last_frame_num_elements);
+                UIStats *stats = &ui->stats;
+                textf_out(ui, "Vertices: %d Elements: %d Instances: %d Shapes: %d Commands: %d", 
+                          stats->num_vertices, stats->num_elements, stats->num_instances, stats->num_shapes, stats->num_commands);
+                newline(ui);
+                textf_out(ui, "Draw calls: %d Culled panels: %d Culled vertices: %d", 
+                          stats->num_draw_calls, stats->num_culled_panels, stats->num_culled_vertices);
+                newline(ui);
+                char *uploaded_unit = "B";
+                usize uploaded_size = stats->num_bytes_uploaded;
+                change_unit_and_size(&uploaded_unit, &uploaded_size);
+                textf_out(ui, "Uploaded: %d%s Cached vertices: %d", uploaded_size, uploaded_unit, stats->num_cached_vertices);
+                newline(ui);
+                char *panel_texture_unit = "B";
+                usize panel_texture_size = stats->num_panel_texture_bytes;
+                change_unit_and_size(&panel_texture_unit, &panel_texture_size);
+                textf_out(ui, "Panel textures drawn: %d Size: %d%s", stats->num_panel_textures_drawn, panel_texture_size, panel_texture_unit);
+                newline(ui);
+                char *text_run_unit = "B";
+                usize text_run_size = stats->num_text_run_bytes;
+                change_unit_and_size(&text_run_unit, &text_run_size);
+                textf_out(ui, "Text runs: %d Size: %d%s", stats->num_text_runs, text_run_size, text_run_unit);
+                newline(ui);
+                textf_out(ui, "Atlas glyphs rasterized: %d Evictions: %d", stats->num_atlas_glyphs_rasterized, stats->num_glyph_atlas_evictions);
+                newline(ui);
+                textf_out(ui, "Cycles per quad%s AoS: %.1f SoA: %.1f", VERTEX_STREAMS_BENCHMARK_BUILD,
+                          vertex_streams_benchmark.aos_cycles_per_quad, vertex_streams_benchmark.soa_cycles_per_quad);
                 newline(ui);
                 textf_out(ui, "Memory blocks: %d Total: %d%s Used: %d%s", 
                           memory_stats.num_memblocks, total_size, total_size_unit, total_used, total_used_unit);
@@ -311,7 +1753,7 @@ static UPDATE_AND_RENDER(update_and_render)
             ui->next_panel_pos = v2(350.0f, 30.0f);
             ui->next_panel_size = v2(300.0f, 500.0f);
 
-            Panel *panel = begin_panel(ui, "Test", PanelFlag_Default);
+            Panel *panel = begin_panel(ui, "Test", PanelFlag_Default | PanelFlag_CacheGeometry | PanelFlag_CacheTexture);
             {
                 test_panel_hierarchy(ui, ui->root_panel);
                 
@@ -320,12 +1762,43 @@ static UPDATE_AND_RENDER(update_and_render)
                 {
                     toggle_value = !toggle_value;
                 }
+                newline(ui);
+
+                checkbox(ui, "Toggle value", &toggle_value);
             }
             end_panel(ui);
         }
 
-        last_frame_num_vertices = ui->num_vertices;
-        last_frame_num_elements = ui->num_elements;
     }
-    render_ui(ui, window_width, window_height);
+    complete_panel_jobs(ui);
+
+    PlatformFrame frame = {};
+    if (ui->frame_pipelined)
+    {
+        queue_frame_packet(ui, window_width, window_height);
+        frame.queued = true;
+    }
+    else
+    {
+        frame.rendered = !(ui->idle_mode && is_frame_presented(ui, window_width, window_height));
+        if (frame.rendered)
+        {
+            render_ui(ui, window_width, window_height);
+        }
+        else
+        {
+            skip_frame(ui);
+        }
+    }
+    frame.pipelined = ui->pipelined;
+
+    frame.wants_next_frame = (!ui->idle_mode || ui->frame_requested || ui->num_settle_frames);
+    frame.wakeup_seconds = ui->wakeup_seconds;
+    if (ui->num_settle_frames)
+    {
+        --ui->num_settle_frames;
+    }
+    ui->frame_requested = false;
+    ui->wakeup_seconds = 0.0f;
+    return frame;
 }
@@ -1,8 +1,64 @@
+#ifndef GUI_COMPACT_VERTICES
+    #define GUI_COMPACT_VERTICES 0
+#endif
+
+#ifndef GUI_SOA_VERTICES
+    #define GUI_SOA_VERTICES 0
+#endif
+
+struct vec2_i16
+{
+    i16 x, y;
+};
+
+struct vec2_u16
+{
+    u16 u, v;
+};
+
+// NOTE(dan): VERTEX_ATTRIB(name, type, num_components, gl_type, normalized)
+#if GUI_COMPACT_VERTICES
+    // NOTE(dan): 12 bytes, positions are fixed point with 3 fractional bits, uvs are normalized,
+    //            16 bits then only reach -4096 to 4095.875 pixels, so every position has to stay within
+    //            VERTEX_POS_LIMIT of the origin it is drawn relative to, turn on local_coords for big surfaces
+    #define VERTEX_POS_FRACTION_BITS    3
+    #define VERTEX_ATTRIB_LIST \
+        VERTEX_ATTRIB(pos,   vec2_i16, 2, GL_SHORT,          GL_FALSE) \
+        VERTEX_ATTRIB(uv,    vec2_u16, 2, GL_UNSIGNED_SHORT, GL_TRUE) \
+        VERTEX_ATTRIB(color, u32,      4, GL_UNSIGNED_BYTE,  GL_TRUE)
+#else
+    // NOTE(dan): 20 bytes
+    #define VERTEX_POS_FRACTION_BITS    0
+    #define VERTEX_ATTRIB_LIST \
+        VERTEX_ATTRIB(pos,   vec2,     2, GL_FLOAT,          GL_FALSE) \
+        VERTEX_ATTRIB(uv,    vec2,     2, GL_FLOAT,          GL_FALSE) \
+        VERTEX_ATTRIB(color, u32,      4, GL_UNSIGNED_BYTE,  GL_TRUE)
+#endif
+
+// NOTE(dan): textures bound to units at once, drawing from a different one does not break a batch,
+//            must match the size of the sampler array in ui_fragment_shader
+#define MAX_NUM_TEXTURE_SLOTS 8
+#define FONT_TEXTURE_SLOT 0
+
+// NOTE(dan): rebound for every panel drawn from its texture, see draw_panel
+#define PANEL_TEXTURE_SLOT (MAX_NUM_TEXTURE_SLOTS - 1)
+
+// NOTE(dan): the texture slot of a vertex rides in the top bits of u as 16 bit fixed point, which leaves 13 bits 
+//            for u itself, ui_vertex_shader splits them apart again and must match these
+#define VERTEX_SLOT_SHIFT   13
+#define VERTEX_U_MAX        ((1 << VERTEX_SLOT_SHIFT) - 1)
+
+typedef char test_texture_slots[MAX_NUM_TEXTURE_SLOTS <= (65536 >> VERTEX_SLOT_SHIFT) ? 1 : -1];
+
+// NOTE(dan): the projection matrix undoes this, so the shaders do not care about the format
+#define VERTEX_POS_SCALE    ((f32)(1 << VERTEX_POS_FRACTION_BITS))
+#define VERTEX_POS_LIMIT    ((f32)(32768 >> VERTEX_POS_FRACTION_BITS))
+
 enum
 {
-    attrib_pos,
-    attrib_uv,
-    attrib_color,
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) attrib_##name,
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
 
     attrib_count,
 };
@@ -11,15 +67,315 @@ enum
 {
     uniform_tex,
     uniform_proj_mat,
+    uniform_translation,
+    uniform_sdf_slot,
+    uniform_sdf_texture_size,
+    uniform_sdf_distance_scale,
 
     uniform_count,
 };
 
 struct Vertex
 {
-    vec2 pos;
-    vec2 uv;
-    u32 color;
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) type name;
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+};
+
+// NOTE(dan): the same in both formats, the compact one just rounds it to 16 bits
+inline f32 get_vertex_u(f32 u, u32 slot)
+{
+    f32 result = ((f32)(slot << VERTEX_SLOT_SHIFT) + u * (f32)VERTEX_U_MAX) * (1.0f / 65535.0f);
+    return result;
+}
+
+#if GUI_COMPACT_VERTICES
+typedef char test_size_vertex[sizeof(Vertex) == 12 ? 1 : -1];
+
+inline i16 pack_vertex_pos(f32 value)
+{
+    i32 fixed = floor32(value * VERTEX_POS_SCALE + 0.5f);
+    assert((fixed >= -32768) && (fixed <= 32767));
+
+    // NOTE(dan): builds without asserts still saturate rather than wrap around
+    fixed = (fixed < -32768) ? -32768 : fixed;
+    fixed = (fixed >  32767) ?  32767 : fixed;
+    return (i16)fixed;
+}
+
+inline u16 pack_vertex_uv(f32 value)
+{
+    u16 result = (u16)(value * 65535.0f + 0.5f);
+    return result;
+}
+
+inline void set_vertex(Vertex *vertex, vec2 pos, vec2 uv, u32 color, u32 slot = FONT_TEXTURE_SLOT)
+{
+    vertex->pos.x = pack_vertex_pos(pos.x);
+    vertex->pos.y = pack_vertex_pos(pos.y);
+    vertex->uv.u = pack_vertex_uv(get_vertex_u(uv.u, slot));
+    vertex->uv.v = pack_vertex_uv(uv.v);
+    vertex->color = color;
+}
+#else
+typedef char test_size_vertex[sizeof(Vertex) == 20 ? 1 : -1];
+
+inline void set_vertex(Vertex *vertex, vec2 pos, vec2 uv, u32 color, u32 slot = FONT_TEXTURE_SLOT)
+{
+    vertex->pos = pos;
+    vertex->uv = v2(get_vertex_u(uv.u, slot), uv.v);
+    vertex->color = color;
+}
+#endif
+
+// NOTE(dan): the same vertices either interleaved in one stream, or with every attribute in its own stream
+struct AosVertexStreams
+{
+    Vertex *vertices;
+};
+
+struct SoaVertexStreams
+{
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) type *name;
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+};
+
+inline void set_vertex(AosVertexStreams *streams, u32 index, vec2 pos, vec2 uv, u32 color, u32 slot = FONT_TEXTURE_SLOT)
+{
+    set_vertex(streams->vertices + index, pos, uv, color, slot);
+}
+
+inline void set_vertex(SoaVertexStreams *streams, u32 index, vec2 pos, vec2 uv, u32 color, u32 slot = FONT_TEXTURE_SLOT)
+{
+    Vertex vertex;
+    set_vertex(&vertex, pos, uv, color, slot);
+
+    streams->pos[index] = vertex.pos;
+    streams->uv[index] = vertex.uv;
+    streams->color[index] = vertex.color;
+}
+
+#if GUI_SOA_VERTICES
+    typedef SoaVertexStreams VertexStreams;
+    #define NUM_VERTEX_STREAMS attrib_count
+#else
+    typedef AosVertexStreams VertexStreams;
+    #define NUM_VERTEX_STREAMS 1
+#endif
+
+#define NUM_STREAM_REGIONS 3
+
+struct StreamBuffer
+{
+    GLuint buffer;
+    GLenum target;
+    u32 region_size;
+
+    // NOTE(dan): base of the persistent mapping, covering all regions, 0 when the regions are mapped per frame
+    u8 *mapped_base;
+};
+
+// NOTE(dan): INSTANCE_ATTRIB(name, type, num_components, gl_type, normalized)
+//            a rect, a glyph or an image in 40 bytes, the vertex path needs 4 vertices and 6 elements for it
+#define INSTANCE_ATTRIB_LIST \
+    INSTANCE_ATTRIB(min_pos, vec2, 2, GL_FLOAT,         GL_FALSE) \
+    INSTANCE_ATTRIB(size,    vec2, 2, GL_FLOAT,         GL_FALSE) \
+    INSTANCE_ATTRIB(min_uv,  vec2, 2, GL_FLOAT,         GL_FALSE) \
+    INSTANCE_ATTRIB(max_uv,  vec2, 2, GL_FLOAT,         GL_FALSE) \
+    INSTANCE_ATTRIB(color,   u32,  4, GL_UNSIGNED_BYTE, GL_TRUE) \
+    INSTANCE_ATTRIB(slot,    u32,  1, GL_UNSIGNED_INT,  GL_FALSE)
+
+enum
+{
+    #define INSTANCE_ATTRIB(name, type, num_components, gl_type, normalized) instance_attrib_##name,
+    INSTANCE_ATTRIB_LIST
+    #undef INSTANCE_ATTRIB
+
+    instance_attrib_count,
+};
+
+struct QuadInstance
+{
+    #define INSTANCE_ATTRIB(name, type, num_components, gl_type, normalized) type name;
+    INSTANCE_ATTRIB_LIST
+    #undef INSTANCE_ATTRIB
+};
+
+// NOTE(dan): SHAPE_ATTRIB(name, type, num_components, gl_type, normalized)
+//            a rounded rect, circle, border or shadow in 48 bytes, the fragment shader evaluates its distance field
+#define SHAPE_ATTRIB_LIST \
+    SHAPE_ATTRIB(min_pos,      vec2, 2, GL_FLOAT,         GL_FALSE) \
+    SHAPE_ATTRIB(size,         vec2, 2, GL_FLOAT,         GL_FALSE) \
+    SHAPE_ATTRIB(radius,       f32,  1, GL_FLOAT,         GL_FALSE) \
+    SHAPE_ATTRIB(border_width, f32,  1, GL_FLOAT,         GL_FALSE) \
+    SHAPE_ATTRIB(softness,     f32,  1, GL_FLOAT,         GL_FALSE) \
+    SHAPE_ATTRIB(color,        u32,  4, GL_UNSIGNED_BYTE, GL_TRUE) \
+    SHAPE_ATTRIB(clip_rect,    rect2, 4, GL_FLOAT,        GL_FALSE)
+
+enum
+{
+    #define SHAPE_ATTRIB(name, type, num_components, gl_type, normalized) shape_attrib_##name,
+    SHAPE_ATTRIB_LIST
+    #undef SHAPE_ATTRIB
+
+    shape_attrib_count,
+};
+
+struct ShapeInstance
+{
+    #define SHAPE_ATTRIB(name, type, num_components, gl_type, normalized) type name;
+    SHAPE_ATTRIB_LIST
+    #undef SHAPE_ATTRIB
+};
+
+enum DrawCommandType
+{
+    DrawCommand_Quads,
+    DrawCommand_Elements,
+    DrawCommand_Instances,
+    DrawCommand_Shapes,
+
+    // NOTE(dan): stands in for the commands of a panel job until they are spliced in, first is the index of the job
+    DrawCommand_Job,
+};
+
+struct DrawCommand
+{
+    DrawCommandType type;
+
+    // NOTE(dan): quads: first vertex and number of quads, elements: first element and number of elements,
+    //            instances and shapes: first instance and number of instances
+    u32 first;
+    u32 count;
+
+    // NOTE(dan): added to the positions in the shader, the origin of the panel with local coordinates
+    vec2 translation;
+};
+
+enum UploadCounter
+{
+    UploadCounter_Vertices,
+    UploadCounter_Elements,
+    UploadCounter_Instances,
+    UploadCounter_Shapes,
+
+    UploadCounter_Count,
+};
+
+// NOTE(dan): the vertex streams, then elements, instances and shapes
+#define NUM_UPLOAD_STREAMS (NUM_VERTEX_STREAMS + 3)
+
+struct UploadStream
+{
+    StreamBuffer *stream;
+    UploadCounter counter;
+    u32 element_size;
+
+    // NOTE(dan): where the stream is written this frame
+    u8 *base;
+
+    // NOTE(dan): system memory copy of a region, written instead of the mapped region with retained buffers
+    u8 *staging;
+};
+
+#define MAX_NUM_UPLOAD_SEGMENTS 512
+
+// NOTE(dan): what was emitted between two panel boundaries
+struct UploadSegment
+{
+    u32 begin[UploadCounter_Count];
+    u32 end[UploadCounter_Count];
+    u64 hash;
+};
+
+// NOTE(dan): circles take every n-th point of the table, 240 has a lot of divisors
+#define CIRCLE_TABLE_SIZE 240
+#define MIN_CIRCLE_SEGMENTS 6
+#define MAX_CIRCLE_TABLE_RADIUS 256
+#define CIRCLE_MAX_ERROR 0.3f
+
+enum LineJoin
+{
+    LineJoin_Miter,
+    LineJoin_Bevel,
+    LineJoin_Round,
+};
+
+enum LineCap
+{
+    LineCap_Butt,
+    LineCap_Square,
+    LineCap_Round,
+};
+
+enum PathCommandType
+{
+    PathCommand_MoveTo,
+    PathCommand_LineTo,
+    PathCommand_QuadTo,
+    PathCommand_CubicTo,
+    PathCommand_ArcTo,
+    PathCommand_Close,
+};
+
+// NOTE(dan): curves: the control points and then the end point, arcs: the center in the first point
+struct PathCommand
+{
+    PathCommandType type;
+    vec2 points[3];
+    f32 radius;
+    f32 start_angle;
+    f32 end_angle;
+};
+
+struct PathSubpath
+{
+    u32 first_point;
+    u32 num_points;
+    b32 closed;
+};
+
+// NOTE(dan): a path flattened at a scale, kept as long as it is drawn every frame, see get_flattened_path
+struct FlattenedPath
+{
+    u64 key;
+    u32 frame_index;
+
+    u32 num_points;
+    vec2 *points;
+
+    u32 num_subpaths;
+    PathSubpath *subpaths;
+};
+
+#define NUM_IDLE_SETTLE_FRAMES 2
+
+#define MAX_NUM_PATH_COMMANDS 1024
+#define PATH_CACHE_SIZE 256
+#define MAX_NUM_GEOMETRY_CHECKPOINTS 4096
+
+// NOTE(dan): the signature of the widgets up to and including this one, counts are where the widget started emitting
+struct GeometryCheckpoint
+{
+    u64 signature;
+    u32 counts[UploadCounter_Count];
+};
+
+// NOTE(dan): what a panel emitted last frame, counts and the first of the commands are relative to the panel, 
+//            elements are relative to the first vertex of the panel
+struct PanelGeometry
+{
+    u32 num_checkpoints;
+    GeometryCheckpoint *checkpoints;
+
+    u8 *streams[NUM_UPLOAD_STREAMS];
+
+    u32 num_commands;
+    DrawCommand *commands;
+
+    // NOTE(dan): bands of the glyph atlas the geometry uses, they are kept while it is replayed
+    u32 glyph_atlas_bands;
 };
 
 struct Glyph
@@ -31,14 +387,34 @@ struct Glyph
     vec2 max_pos;
     vec2 min_uv;
     vec2 max_uv;
+
+    // NOTE(dan): only glyphs of the glyph atlas have a font glyph index, their uvs are valid while the band they were 
+    //            packed in has the same generation
+    i32 font_glyph_index;
+    u32 atlas_band;
+    u32 atlas_generation;
 };
 
-struct Font
+#define MAX_UNICODE_CODEPOINT 0x10FFFF
+#define GLYPH_PAGE_SHIFT 8
+#define GLYPH_PAGE_SIZE (1 << GLYPH_PAGE_SHIFT)
+#define NUM_GLYPH_PAGES ((MAX_UNICODE_CODEPOINT + 1) >> GLYPH_PAGE_SHIFT)
+#define NUM_ASCII_CODEPOINTS 128
+#define MISSING_GLYPH 0xFFFF
+#define UNICODE_REPLACEMENT_CHARACTER 0xFFFD
+
+// NOTE(dan): bytes of printable ascii shaped at once, see shape_text_run
+#define TEXT_SIMD_BLOCK_SIZE 16
+
+struct GlyphPage
 {
-    // TODO(dan): store only the kern table from font_info
-    stbtt_fontinfo font_info;
+    u16 glyph_indices[GLYPH_PAGE_SIZE];
+};
 
+struct Font
+{
     vec2 white_pixel_uv;
+    u32 texture_slot;
     f32 size;
     u32 texture_width;
     u32 texture_height;
@@ -47,11 +423,133 @@ struct Font
     f32 descent;
 
     u32 num_glyphs;
-    Glyph glyphs[256];
-    f32 advance_x_lut[256];
-    u16 glyph_index_lut[256];
+    Glyph *glyphs;
+
+    // NOTE(dan): codepoint -> glyph index, pages without glyphs all point at the same page of MISSING_GLYPH, 
+    //            the page after the last one catches codepoints past the unicode range
+    GlyphPage **glyph_pages;
+    u16 ascii_glyph_indices[NUM_ASCII_CODEPOINTS];
+    f32 ascii_advances_x[NUM_ASCII_CODEPOINTS];
+    b32 has_printable_ascii;
+
+    // NOTE(dan): bit right of row left is set when the ascii pair has kerning, shaping only searches those pairs
+    u32 ascii_kern_bits[NUM_ASCII_CODEPOINTS][NUM_ASCII_CODEPOINTS / 32];
+
+    // NOTE(dan): kerning of the glyph pairs, pre-scaled to the font size, the pairs with a glyph on the left are 
+    //            [kern_pair_offsets[glyph_index], kern_pair_offsets[glyph_index + 1]), sorted by the right glyph
+    u32 num_kern_pairs;
+    u32 *kern_pair_offsets;
+    u16 *kern_pair_glyphs;
+    f32 *kern_pair_advances;
+};
+
+// NOTE(dan): the sdf font is baked once at SDF_FONT_SIZE and serves every text size, the alpha of its texels is the 
+//            distance to the glyph outline, SDF_ON_EDGE_VALUE on it and SDF_PIXEL_DIST_SCALE more per texel inside
+#define SDF_FONT_SIZE 32.0f
+#define SDF_PADDING 4
+#define SDF_ON_EDGE_VALUE 128
+#define SDF_PIXEL_DIST_SCALE ((f32)SDF_ON_EDGE_VALUE / SDF_PADDING)
+#define SDF_TEXTURE_WIDTH 512
+
+// NOTE(dan): glyphs outside the baked ranges are rasterized into the glyph atlas the first time they are drawn, the 
+//            atlas is split into bands that are packed with a skyline each, when none has room the least recently used 
+//            band is cleared and its glyphs are rasterized again when they are drawn next
+#define GLYPH_ATLAS_WIDTH 512
+#define GLYPH_ATLAS_HEIGHT 512
+#define NUM_GLYPH_ATLAS_BANDS 4
+#define GLYPH_ATLAS_BAND_HEIGHT (GLYPH_ATLAS_HEIGHT / NUM_GLYPH_ATLAS_BANDS)
+#define GLYPH_ATLAS_PADDING 1
+#define MAX_NUM_SKYLINE_NODES 64
+
+struct SkylineNode
+{
+    u16 x;
+    u16 y;
+    u16 width;
+};
+
+struct GlyphAtlasBand
+{
+    u32 generation;
+    u32 last_used_frame;
+
+    u32 num_nodes;
+    SkylineNode nodes[MAX_NUM_SKYLINE_NODES];
+};
+
+struct GlyphAtlas
+{
+    // NOTE(dan): panel jobs draw text too
+    Mutex mutex;
+
+    stbtt_fontinfo font_info;
+    f32 font_scale;
+
+    GLuint texture;
+    u32 texture_slot;
+    u32 *pixels;
+
+    // NOTE(dan): rows rasterized into since the last frame packet, they are uploaded before it is drawn
+    u32 dirty_min_y;
+    u32 dirty_max_y;
+
+    u32 num_glyphs_rasterized;
+    u32 num_evictions;
+    GlyphAtlasBand bands[NUM_GLYPH_ATLAS_BANDS];
+};
+
+#define TEXT_RUN_CHUNK_SIZE 16
+
+struct TextRunChunk
+{
+    union
+    {
+        TextRunChunk *next;
+        TextRunChunk *next_free;
+    };
+
+    // NOTE(dan): glyphs of the run, or the bytes of the text it was shaped from
+    union
+    {
+        struct
+        {
+            u16 glyph_indices[TEXT_RUN_CHUNK_SIZE];
+            f32 offsets_x[TEXT_RUN_CHUNK_SIZE];
+        };
+        char text[TEXT_RUN_CHUNK_SIZE * (sizeof(u16) + sizeof(f32))];
+    };
+};
+
+// NOTE(dan): a text shaped at a size, the glyphs of the font it uses and the pen position of each, relative to the start
+struct TextRun
+{
+    // NOTE(dan): least recently used first
+    TextRun *next;
+    TextRun *prev;
+
+    union
+    {
+        TextRun *next_in_hash;
+        TextRun *next_free;
+    };
+
+    // NOTE(dan): a hit on the key is checked against what the run was shaped from
+    u64 key;
+    Font *font;
+    f32 font_size;
+    f32 text_size;
+    u32 text_length;
+    TextRunChunk *first_text_chunk;
+
+    vec2 size;
+
+    u32 num_glyphs;
+    TextRunChunk *first_chunk;
 };
 
+#define TEXT_RUN_HASH_SIZE 1024
+#define DEFAULT_TEXT_RUN_BUDGET (256*KB)
+
 enum PanelFlags
 {
     PanelFlag_None,
@@ -65,10 +563,129 @@ enum PanelFlags
 
     PanelFlag_Popup      = 1 << 6,
 
+    // NOTE(dan): only for panels that draw nothing but widgets, see is_geometry_cached
+    PanelFlag_CacheGeometry = 1 << 7,
+
+    // NOTE(dan): the same goes for this, the panel is drawn into a texture when its signature or size changes and 
+    //            as a single quad otherwise, only opaque panels are, see end_panel_texture
+    PanelFlag_CacheTexture  = 1 << 8,
+
     PanelFlag_Resizable = (PanelFlag_ResizableX | PanelFlag_ResizableY),
     PanelFlag_Default   = (PanelFlag_Movable | PanelFlag_Resizable | PanelFlag_HasHeader | PanelFlag_Bordered),
 };
 
+// NOTE(dan): entries without a panel are free, their texture is deleted on the next render
+struct PanelTexture
+{
+    struct Panel *panel;
+    u64 signature;
+    u32 last_used_frame;
+
+    // NOTE(dan): the texture covers the panel from origin on, offset is where the panel starts in it
+    vec2 origin;
+    vec2 offset;
+    u32 width;
+    u32 height;
+
+    GLuint texture;
+    GLuint framebuffer;
+    u32 texture_width;
+    u32 texture_height;
+};
+
+#define MAX_NUM_PANEL_TEXTURES 32
+#define DEFAULT_PANEL_TEXTURE_BUDGET (64*MB)
+
+enum RenderOpType
+{
+    RenderOp_Commands,
+    RenderOp_Flush,
+    RenderOp_Scissor,
+
+    RenderOp_BeginPanelTexture,
+    RenderOp_EndPanelTexture,
+    RenderOp_BindPanelTexture,
+    RenderOp_UnbindPanelTexture,
+    RenderOp_DeletePanelTexture,
+};
+
+// NOTE(dan): the panels are walked when the frame is built, the renderer only follows these, 
+//            the gl objects of a panel texture are only touched by the renderer, everything else of it is copied
+struct RenderOp
+{
+    RenderOpType type;
+
+    // NOTE(dan): commands: the range of commands, scissor: the rect with y pointing up
+    u32 first;
+    u32 count;
+    rect2 rect;
+
+    PanelTexture *texture;
+    vec2 origin;
+    u32 width;
+    u32 height;
+};
+
+#define MAX_NUM_RENDER_OPS 4096
+
+// NOTE(dan): counts of the last rendered frame, vertices of instances and shapes are counted as 4 each
+struct UIStats
+{
+    u32 num_vertices;
+    u32 num_elements;
+    u32 num_instances;
+    u32 num_shapes;
+    u32 num_commands;
+    u32 num_draw_calls;
+
+    u32 num_culled_panels;
+    u32 num_culled_vertices;
+
+    u32 num_bytes_uploaded;
+    u32 num_cached_vertices;
+
+    u32 num_panel_texture_bytes;
+    u32 num_panel_textures_drawn;
+
+    u32 num_text_runs;
+    u32 num_text_run_bytes;
+
+    u32 num_atlas_glyphs_rasterized;
+    u32 num_glyph_atlas_evictions;
+};
+
+// NOTE(dan): everything a frame is drawn from, the streams of the packets of the pipelined mode are in system memory 
+//            and copied into a region of the stream buffers when they are drawn, the immediate packet has none 
+//            because the frame is built in the region
+struct FramePacket
+{
+    i32 display_width;
+    i32 display_height;
+    b32 cpu_clipping;
+
+    u32 counts[UploadCounter_Count];
+    u8 *streams[NUM_UPLOAD_STREAMS];
+
+    u32 num_commands;
+    DrawCommand *commands;
+
+    u32 num_render_ops;
+    RenderOp *render_ops;
+
+    u32 num_texture_slots;
+    GLuint texture_slots[MAX_NUM_TEXTURE_SLOTS];
+
+    // NOTE(dan): rows of the glyph atlas to upload before drawing
+    u32 glyph_atlas_min_y;
+    u32 glyph_atlas_max_y;
+
+    // NOTE(dan): filled in by the ui when the packet is recorded and by the renderer when it is drawn, the ui only reads 
+    //            it back after the packet was released, see begin_frame
+    UIStats stats;
+};
+
+#define NUM_FRAME_PACKETS (MAX_NUM_QUEUED_FRAMES + 1)
+
 enum Behavior
 {
     Behavior_Inactive,
@@ -105,8 +722,36 @@ struct Panel
 
     f32 current_line_height;
 
-    u32 begin_element_index;
-    u32 num_elements;
+    u32 begin_command_index;
+    u32 num_commands;
+
+    // NOTE(dan): the command range is only valid when the panel was begun in the current frame
+    u32 frame_index;
+
+    // NOTE(dan): opaque panels hide everything below them, culled panels are left out when the frame is recorded
+    b32 opaque;
+    b32 culled;
+    u32 begin_num_vertices;
+    u32 num_vertices;
+
+    // NOTE(dan): what the positions of the panel are relative to, see UIState::local_coords
+    vec2 origin;
+
+    // NOTE(dan): geometry of the last frame, replayed as long as the signatures of the widgets match
+    PanelGeometry *geometry;
+    b32 replay_geometry;
+    b32 record_geometry;
+    u32 glyph_atlas_bands;
+    u64 signature;
+    u32 num_signatures;
+    u32 begin_checkpoint_index;
+    u32 geometry_begin[UploadCounter_Count];
+
+    // NOTE(dan): the commands from composite_command_index on draw the texture, the ones before draw into it when dirty
+    PanelTexture *texture;
+    b32 cache_texture;
+    b32 texture_dirty;
+    u32 composite_command_index;
 };
 
 inline Panel *get_panel_sentinel(Panel *from)
@@ -162,12 +807,23 @@ struct Style
     };
 };
 
+// NOTE(dan): the tables and caches only the main thread uses live out of line, so the copy a panel job builds with 
+//            stays small, see queue_panel_job
 struct UIState
 {
     // NOTE(dan): storage
 
     PlatformInput *input;
 
+    // NOTE(dan): after input a few more frames are built for the state it changed, then the platform waits for input 
+    //            unless something asks for a frame, frames that draw what was presented last are not rendered
+    b32 idle_mode;
+    u32 num_settle_frames;
+    b32 frame_requested;
+    f32 wakeup_seconds;
+    b32 presented;
+    u64 presented_hash;
+
     vec2 mouse_pos;
     vec2 prev_mouse_pos;
     vec2 delta_mouse_pos;
@@ -176,7 +832,13 @@ struct UIState
     MemoryStack memory;
     MemoryStack font_memory;
 
-    Font current_font;
+    Font *current_font;
+
+    // NOTE(dan): text draws from this instead of the current font with sdf_text, see get_text_font, it only has the 
+    //            baked glyphs, the ones of the glyph atlas are left out of sdf text
+    b32 sdf_text;
+    Font *sdf_font;
+    GLuint sdf_texture;
 
     // TODO(dan): how do we want to store styles?
 
@@ -204,23 +866,188 @@ struct UIState
     Panel *current_panel;
     Panel *active_panel;
 
+    u32 frame_index;
+
+    // NOTE(dan): panel geometry and flattened paths are recorded into one stack while last frame's are used from the other
+    b32 cache_geometry;
+    u32 geometry_memory_index;
+    MemoryStack geometry_memory[2];
+    TempMemoryStack geometry_frame_memory[2];
+
+    u32 num_geometry_checkpoints;
+    GeometryCheckpoint *geometry_checkpoints;
+    u32 num_cached_vertices;
+
+    // NOTE(dan): the path being built, flattened paths live in the geometry stacks too
+    vec2 path_offset;
+    f32 path_scale;
+    u32 num_path_commands;
+    PathCommand *path_commands;
+    FlattenedPath *path_cache;
+
+    // NOTE(dan): the least recently drawn panel textures are evicted to stay in the budget
+    b32 cache_textures;
+    u32 panel_texture_budget;
+    u32 num_panel_texture_bytes;
+    b32 panel_textures_dirty;
+    PanelTexture *panel_textures;
+
+    // NOTE(dan): shaped texts, the least recently used ones are evicted to stay in the budget, see get_text_run
+    b32 cache_text_runs;
+    u32 text_run_budget;
+    u32 num_text_run_bytes;
+    u32 num_text_runs;
+    MemoryStack text_run_memory;
+    TextRun text_run_sentinel;
+    TextRun *first_free_text_run;
+    TextRunChunk *first_free_text_run_chunk;
+    TextRun **text_run_hash;
+
     // NOTE(dan): draw
 
     GLuint program;
     GLuint texture;
+    GlyphAtlas *glyph_atlas;
+
+    u32 num_texture_slots;
+    GLuint texture_slots[MAX_NUM_TEXTURE_SLOTS];
 
-    GLuint vbo;
     GLuint vao;
-    GLuint ebo;
 
     GLuint attribs[attrib_count];
     GLuint uniforms[uniform_count];
 
-    Vertex *vertices;
+    // NOTE(dan): single colored rects and glyphs are expanded from a unit quad in the shader when this is set
+    b32 use_instancing;
+
+    GLuint instance_program;
+    GLuint instance_vao;
+
+    GLuint instance_attribs[instance_attrib_count];
+    GLuint instance_uniforms[uniform_count];
+
+    GLuint shape_program;
+    GLuint shape_vao;
+
+    GLuint shape_attribs[shape_attrib_count];
+    GLuint shape_uniforms[uniform_count];
+
+    GLuint bound_program;
+    b32 bound_translation_valid;
+    vec2 bound_translation;
+
+    // NOTE(dan): unit circle, y points down, see init_circle_tables
+    vec2 *circle_table;
+    u8 *circle_segment_counts;
+
+    // NOTE(dan): panels emit relative to their top left corner and are translated when they are drawn when this is set, 
+    //            so moving a panel does not touch its vertices and does not invalidate its cached geometry
+    b32 local_coords;
+    vec2 draw_origin;
+
+    // NOTE(dan): primitives are clipped to clip_rect while they are emitted when this is set, so that panels 
+    //            do not need a scissor and their commands can be merged into as few draws as possible
+    b32 cpu_clipping;
+    rect2 clip_rect;
+
+    DrawCommand pending_command;
+
+    // NOTE(dan): top level panels covered by opaque panels above them are not drawn, see record_panel
+    b32 occlusion_culling;
+    u32 num_culled_panels;
+    u32 num_culled_vertices;
+
+    // NOTE(dan): stats of the last frame that was drawn, frame_stats are the ones of the packet being drawn and are 
+    //            only touched by the renderer
+    UIStats stats;
+    UIStats *frame_stats;
+
+    // NOTE(dan): vertices and elements are written straight into the current region of the stream buffers
+    b32 persistent_streams;
+    u32 stream_region_index;
+    GLsync stream_fences[NUM_STREAM_REGIONS];
+
+    StreamBuffer vertex_streams[NUM_VERTEX_STREAMS];
+    StreamBuffer element_stream;
+    StreamBuffer instance_stream;
+    StreamBuffer shape_stream;
+
+    UploadStream upload_streams[NUM_UPLOAD_STREAMS];
+
+    // NOTE(dan): with retained buffers the streams are built in system memory, the region does not change and only 
+    //            the segments that differ from the last frame are copied into it with BufferSubData
+    b32 retained_buffers;
+    b32 frame_retained;
+
+    u32 upload_segment_begin[UploadCounter_Count];
+    u32 num_upload_segments;
+    u32 num_prev_upload_segments;
+    UploadSegment *upload_segments;
+    UploadSegment *prev_upload_segments;
+
+    // NOTE(dan): quads are indexed from this one, only polygons write to the element stream
+    GLuint quad_element_buffer;
+    GLuint bound_element_buffer;
+
+    VertexStreams vertices;
     GLuint *elements;
+    QuadInstance *instances;
+    ShapeInstance *shapes;
+    DrawCommand *commands;
 
     u32 num_vertices;
     u32 num_elements;
+    u32 num_instances;
+    u32 num_shapes;
+    u32 num_commands;
+    u32 command_barrier;
+
+    // NOTE(dan): with pipelined frames the packets are a single producer, single consumer ring, the ui thread only 
+    //            writes num_packets_written and the render thread only num_packets_read
+    b32 pipelined;
+    b32 frame_pipelined;
+    FramePacket *packet;
+    FramePacket immediate_packet;
+    FramePacket *frame_packets;
+    u32 volatile num_packets_written;
+    u32 volatile num_packets_read;
+    u32 num_stats_packets_read;
+
+    // NOTE(dan): panel contents built on the worker threads, see queue_panel_job, job is set in the ui of a job
+    PlatformWorkQueue *work_queue;
+    u32 num_panel_jobs;
+    struct PanelJob *panel_jobs;
+    struct PanelJob *job;
+};
+
+#define PANEL_JOB_CALLBACK(name) void name(UIState *ui, void *data)
+typedef PANEL_JOB_CALLBACK(PanelJobCallback);
+
+#define MAX_NUM_PANEL_JOBS 32
+
+// NOTE(dan): job streams start at this fraction of a region and double when they are full, see reserve_stream_room
+#define JOB_STREAM_CAPACITY_SHIFT 6
+
+// NOTE(dan): the job builds into its own copy of the ui, with a copy of the panel as the current one and streams and 
+//            commands that start at 0, the streams and commands are allocated the first time the job is used
+struct PanelJob
+{
+    PanelJobCallback *callback;
+    void *data;
+
+    Panel *owner;
+    Panel panel;
+    UIState ui;
+
+    MemoryStack memory;
+    MemoryStack path_memory;
+    TempMemoryStack path_frame_memory;
+
+    u8 *streams[NUM_UPLOAD_STREAMS];
+    u32 stream_capacities[UploadCounter_Count];
+    DrawCommand *commands;
+    PathCommand *path_commands;
+    FlattenedPath *path_cache;
 };
 
 #define push_style(ui, dest_init, value, t) \
@@ -27,6 +27,7 @@ static char *ui_vertex_shader = R"GLSL(
     #version 330
 
     uniform mat4 proj_mat;
+    uniform vec2 translation;
 
     in vec2 pos;
     in vec2 uv;
@@ -34,28 +35,173 @@ static char *ui_vertex_shader = R"GLSL(
 
     out vec2 frag_uv;
     out vec4 frag_color;
+    flat out int frag_slot;
 
     void main()
     {
-        frag_uv = uv;
+        // NOTE(dan): u carries the texture slot in its top bits, see VERTEX_SLOT_SHIFT
+        float packed_u = uv.x * 65535.0f;
+        float slot = floor((packed_u + 0.5f) / 8192.0f);
+        frag_uv = vec2((packed_u - slot * 8192.0f) / 8191.0f, uv.y);
         frag_color = color;
-        gl_Position = proj_mat * vec4(pos.xy, 0.0f, 1.0f);
+        frag_slot = int(slot);
+        gl_Position = proj_mat * vec4(pos.xy + translation, 0.0f, 1.0f);
+    }
+)GLSL";
+
+static char *ui_instance_vertex_shader = R"GLSL(
+    #version 330
+
+    uniform mat4 proj_mat;
+    uniform vec2 translation;
+
+    in vec2 instance_min_pos;
+    in vec2 instance_size;
+    in vec2 instance_min_uv;
+    in vec2 instance_max_uv;
+    in vec4 instance_color;
+    in float instance_slot;
+
+    out vec2 frag_uv;
+    out vec4 frag_color;
+    flat out int frag_slot;
+
+    void main()
+    {
+        // NOTE(dan): unit quad as a triangle strip, (0, 0) (0, 1) (1, 0) (1, 1)
+        vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);
+
+        frag_uv = mix(instance_min_uv, instance_max_uv, corner);
+        frag_color = instance_color;
+        frag_slot = int(instance_slot);
+        gl_Position = proj_mat * vec4(instance_min_pos + corner * instance_size + translation, 0.0f, 1.0f);
     }
 )GLSL";
 
 static char *ui_fragment_shader = R"GLSL(
     #version 330
 
-    uniform sampler2D tex;
+    uniform sampler2D textures[8];
+    uniform int sdf_slot;
+    uniform vec2 sdf_texture_size;
+    uniform float sdf_distance_scale;
 
     in vec2 frag_uv;
     in vec4 frag_color;
+    flat in int frag_slot;
     
     out vec4 out_color;
 
+    // NOTE(dan): glsl 3.30 indexes sampler arrays only with constants, 
+    //            the ui textures have no mips so the lod does not need derivatives inside the branches
+    vec4 sample_slot(int slot, vec2 uv)
+    {
+        vec4 result;
+        switch (slot)
+        {
+            case 0:  result = textureLod(textures[0], uv, 0.0f); break;
+            case 1:  result = textureLod(textures[1], uv, 0.0f); break;
+            case 2:  result = textureLod(textures[2], uv, 0.0f); break;
+            case 3:  result = textureLod(textures[3], uv, 0.0f); break;
+            case 4:  result = textureLod(textures[4], uv, 0.0f); break;
+            case 5:  result = textureLod(textures[5], uv, 0.0f); break;
+            case 6:  result = textureLod(textures[6], uv, 0.0f); break;
+            default: result = textureLod(textures[7], uv, 0.0f); break;
+        }
+        return result;
+    }
+
+    void main()
+    {
+        // NOTE(dan): derivatives are undefined inside the branch
+        vec2 texels_per_pixel = fwidth(frag_uv) * sdf_texture_size;
+        vec4 texel = sample_slot(frag_slot, frag_uv);
+
+        // NOTE(dan): the distance to the outline in texels of the sdf font is scaled to pixels, so the edge is 
+        //            antialiased over a pixel at every text size
+        if (frag_slot == sdf_slot)
+        {
+            float distance = (texel.a - 0.5f) * sdf_distance_scale;
+            float pixels_per_texel = 1.0f / max(0.5f * (texels_per_pixel.x + texels_per_pixel.y), 0.0001f);
+            texel = vec4(1.0f, 1.0f, 1.0f, clamp(distance * pixels_per_texel + 0.5f, 0.0f, 1.0f));
+        }
+        out_color = frag_color * texel;
+    }
+)GLSL";
+
+static char *ui_shape_vertex_shader = R"GLSL(
+    #version 330
+
+    uniform mat4 proj_mat;
+    uniform vec2 translation;
+
+    in vec2 shape_min_pos;
+    in vec2 shape_size;
+    in float shape_radius;
+    in float shape_border_width;
+    in float shape_softness;
+    in vec4 shape_color;
+    in vec4 shape_clip_rect;
+
+    out vec2 frag_pos;
+    out vec2 frag_half_size;
+    out float frag_radius;
+    out float frag_border_width;
+    out float frag_softness;
+    out vec4 frag_color;
+
+    void main()
+    {
+        vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);
+        vec2 half_size = 0.5f * shape_size;
+        vec2 center = shape_min_pos + half_size;
+
+        // NOTE(dan): grow the quad so that the anti aliased edge and the soft falloff fit in, 
+        //            clamping it to the clip rect does not change the distances, they are interpolated linearly
+        vec2 pos = center + (2.0f * corner - 1.0f) * (half_size + shape_softness + 1.0f);
+        pos = clamp(pos, shape_clip_rect.xy, shape_clip_rect.zw);
+
+        frag_pos = pos - center;
+        frag_half_size = half_size;
+        frag_radius = shape_radius;
+        frag_border_width = shape_border_width;
+        frag_softness = shape_softness;
+        frag_color = shape_color;
+        gl_Position = proj_mat * vec4(pos + translation, 0.0f, 1.0f);
+    }
+)GLSL";
+
+static char *ui_shape_fragment_shader = R"GLSL(
+    #version 330
+
+    in vec2 frag_pos;
+    in vec2 frag_half_size;
+    in float frag_radius;
+    in float frag_border_width;
+    in float frag_softness;
+    in vec4 frag_color;
+
+    out vec4 out_color;
+
+    float rounded_rect_distance(vec2 pos, vec2 half_size, float radius)
+    {
+        vec2 q = abs(pos) - half_size + radius;
+        return length(max(q, 0.0f)) + min(max(q.x, q.y), 0.0f) - radius;
+    }
+
     void main()
     {
-        out_color = frag_color * texture(tex, frag_uv);
+        float distance = rounded_rect_distance(frag_pos, frag_half_size, frag_radius);
+
+        // NOTE(dan): a pixel wide edge, or a wider one for shadows
+        float falloff = max(frag_softness, 1.0f);
+        float coverage = clamp(0.5f - distance / falloff, 0.0f, 1.0f);
+        if (frag_border_width > 0.0f)
+        {
+            coverage *= clamp(0.5f + (distance + frag_border_width) / falloff, 0.0f, 1.0f);
+        }
+
+        out_color = vec4(frag_color.rgb, frag_color.a * coverage);
     }
 )GLSL";
 
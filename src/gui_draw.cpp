@@ -1,367 +1,2109 @@
 
-static void add_poly_outline(UIState *ui, vec2 *points, u32 point_count, u32 color, f32 thickness, b32 connect_last_with_first)
+inline b32 is_command_followed_by(DrawCommand *command, DrawCommandType type, u32 first)
+{
+    u32 stride = (command->type == DrawCommand_Quads) ? 4 : 1;
+    b32 followed = (command->type == type && (command->first + command->count * stride) == first);
+    return followed;
+}
+
+static DrawCommand *get_draw_command(UIState *ui, DrawCommandType type, u32 first)
 {
-    u32 vertice_index = ui->num_vertices;
-    u32 element_index = ui->num_elements;
+    DrawCommand *command = 0;
 
-    u32 num_points = point_count;
-    if (!connect_last_with_first)
+    // NOTE(dan): extend the last command of the current panel if the new primitives follow it directly
+    if (ui->num_commands > ui->command_barrier)
     {
-        --num_points;
+        command = ui->commands + ui->num_commands - 1;
+        if (!is_command_followed_by(command, type, first) || !vec2_equal(command->translation, ui->draw_origin))
+        {
+            command = 0;
+        }
     }
 
-    u32 num_vertices = num_points * 4;
-    u32 num_elements = num_points * 6;
+    if (!command)
+    {
+        assert(ui->num_commands < MAX_NUM_DRAW_COMMANDS);
+
+        command = ui->commands + ui->num_commands++;
+        command->type = type;
+        command->first = first;
+        command->count = 0;
+        command->translation = ui->draw_origin;
+    }
+    return command;
+}
 
-    assert(ui->num_vertices + num_vertices < MAX_NUM_VERTICES);
-    assert(ui->num_elements + num_elements < MAX_NUM_ELEMENTS);
+// NOTE(dan): instances and shapes count as 4 vertices
+inline u32 get_num_emitted_vertices(UIState *ui)
+{
+    u32 num_vertices = ui->num_vertices + 4 * (ui->num_instances + ui->num_shapes);
+    return num_vertices;
+}
 
-    ui->num_vertices += num_vertices;
-    ui->num_elements += num_elements;
+inline void get_upload_counts(UIState *ui, u32 *counts)
+{
+    counts[UploadCounter_Vertices] = ui->num_vertices;
+    counts[UploadCounter_Elements] = ui->num_elements;
+    counts[UploadCounter_Instances] = ui->num_instances;
+    counts[UploadCounter_Shapes] = ui->num_shapes;
+}
 
-    for (u32 point_index = 0; point_index < num_points; ++point_index)
+static u32 max_upload_counts[UploadCounter_Count] = { MAX_NUM_VERTICES, MAX_NUM_ELEMENTS, MAX_NUM_INSTANCES, MAX_NUM_SHAPES };
+
+static void set_stream_pointers(UIState *ui, u8 **streams)
+{
+#if GUI_SOA_VERTICES
+    #define VERTEX_ATTRIB(name, type, num_components, gl_type, normalized) \
+        ui->vertices.name = (type *)streams[attrib_##name];
+    VERTEX_ATTRIB_LIST
+    #undef VERTEX_ATTRIB
+#else
+    ui->vertices.vertices = (Vertex *)streams[0];
+#endif
+    ui->elements = (GLuint *)streams[NUM_VERTEX_STREAMS + 0];
+    ui->instances = (QuadInstance *)streams[NUM_VERTEX_STREAMS + 1];
+    ui->shapes = (ShapeInstance *)streams[NUM_VERTEX_STREAMS + 2];
+
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        ui->upload_streams[stream_index].base = streams[stream_index];
+    }
+}
+
+// NOTE(dan): moves every stream of the counter into a new allocation that holds at least min_capacity elements
+static void grow_job_streams(UIState *ui, UploadCounter counter, u32 min_capacity)
+{
+    PanelJob *job = ui->job;
+    u32 capacity = job->stream_capacities[counter];
+    while (capacity < min_capacity)
+    {
+        capacity *= 2;
+    }
+    capacity = (capacity < max_upload_counts[counter]) ? capacity : max_upload_counts[counter];
+
+    u32 counts[UploadCounter_Count];
+    get_upload_counts(ui, counts);
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        UploadStream *upload_stream = ui->upload_streams + stream_index;
+        if (upload_stream->counter == counter)
+        {
+            u8 *stream = (u8 *)platform.virtual_alloc(capacity * upload_stream->element_size);
+            assert(stream);
+            copy_memory(stream, job->streams[stream_index], counts[counter] * upload_stream->element_size);
+            platform.virtual_free(job->streams[stream_index]);
+            job->streams[stream_index] = stream;
+        }
+    }
+
+    job->stream_capacities[counter] = capacity;
+    set_stream_pointers(ui, job->streams);
+}
+
+// NOTE(dan): whether count elements of the counter fit in a region, the streams of a job grow to hold them
+inline b32 reserve_stream_room(UIState *ui, UploadCounter counter, u32 count)
+{
+    b32 has_room = (count <= max_upload_counts[counter]);
+    if (has_room && ui->job && count > ui->job->stream_capacities[counter])
     {
-        u32 next_point_index = ((point_index + 1) == point_count) ? 0 : point_index + 1;
+        grow_job_streams(ui, counter, count);
+    }
+    return has_room;
+}
 
-        vec2 current_pos = points[point_index];
-        vec2 next_pos = points[next_point_index];
+#define FNV_HASH_SEED 0xCBF29CE484222325ull
 
-        vec2 delta_pos = vec2_sub(next_pos, current_pos);
-        f32 delta_pos_length2 = vec2_length2(delta_pos);
-        f32 inv_delta_pos_length = inv_sqrt32(delta_pos_length2);
+// NOTE(dan): fnv-1a over words, every stream holds whole words
+static u64 hash_words(u64 hash, void *data, u32 size)
+{
+    u32 *words = (u32 *)data;
+    u32 num_words = size / sizeof(u32);
 
-        delta_pos = vec2_mul(0.5f * thickness * inv_delta_pos_length, delta_pos);
+    for (u32 word_index = 0; word_index < num_words; ++word_index)
+    {
+        hash = (hash ^ words[word_index]) * 0x100000001B3ull;
+    }
+    return hash;
+}
 
-        Vertex *vertex = ui->vertices + vertice_index;
-        GLuint *element = ui->elements + element_index;
-        vec2 uv = ui->current_font.white_pixel_uv;
+static u64 hash_string(u64 hash, char *string)
+{
+    for (u8 *at = (u8 *)string; *at; ++at)
+    {
+        hash = (hash ^ *at) * 0x100000001B3ull;
+    }
+    return hash;
+}
 
-        vertex[0].pos.x = current_pos.x + delta_pos.y;
-        vertex[0].pos.y = current_pos.y - delta_pos.x;
-        vertex[0].uv = uv;
-        vertex[0].color = color;
+// NOTE(dan): closes what was emitted since the last panel boundary, see upload_dirty_segments
+static void close_upload_segment(UIState *ui)
+{
+    if (ui->frame_retained)
+    {
+        u32 counts[UploadCounter_Count];
+        get_upload_counts(ui, counts);
 
-        vertex[1].pos.x = next_pos.x + delta_pos.y;
-        vertex[1].pos.y = next_pos.y - delta_pos.x;
-        vertex[1].uv = uv;
-        vertex[1].color = color;
+        b32 empty = true;
+        for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+        {
+            empty = empty && (counts[counter] == ui->upload_segment_begin[counter]);
+        }
 
-        vertex[2].pos.x = next_pos.x - delta_pos.y;
-        vertex[2].pos.y = next_pos.y + delta_pos.x;
-        vertex[2].uv = uv;
-        vertex[2].color = color;
+        if (!empty)
+        {
+            // NOTE(dan): out of segments, the last one grows to the end of the frame
+            UploadSegment *segment = ui->upload_segments + ui->num_upload_segments;
+            if (ui->num_upload_segments < MAX_NUM_UPLOAD_SEGMENTS)
+            {
+                ++ui->num_upload_segments;
+                for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+                {
+                    segment->begin[counter] = ui->upload_segment_begin[counter];
+                }
+            }
+            else
+            {
+                --segment;
+            }
 
-        vertex[3].pos.x = current_pos.x - delta_pos.y;
-        vertex[3].pos.y = current_pos.y + delta_pos.x;
-        vertex[3].uv = uv;
-        vertex[3].color = color;
+            u64 hash = FNV_HASH_SEED;
+            for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+            {
+                UploadStream *upload_stream = ui->upload_streams + stream_index;
+                u32 begin = segment->begin[upload_stream->counter];
+                u32 end = counts[upload_stream->counter];
 
-        element[0] = vertice_index + 0;
-        element[1] = vertice_index + 1;
-        element[2] = vertice_index + 2;
-        element[3] = vertice_index + 0;
-        element[4] = vertice_index + 2;
-        element[5] = vertice_index + 3;
+                hash = hash_words(hash, upload_stream->staging + begin * upload_stream->element_size, 
+                                  (end - begin) * upload_stream->element_size);
+            }
 
-        vertice_index += 4;
-        element_index += 6;
+            for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+            {
+                segment->end[counter] = counts[counter];
+                ui->upload_segment_begin[counter] = counts[counter];
+            }
+            segment->hash = hash;
+        }
     }
 }
 
-static void add_textured_quad(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, 
-                              vec2 top_left_corner_uv, vec2 bottom_right_corner_uv, u32 color)
+// NOTE(dan): positions are written relative to the origin of the current panel with local coordinates
+inline vec2 get_local_pos(UIState *ui, vec2 pos)
+{
+    vec2 local_pos = vec2_sub(pos, ui->draw_origin);
+    return local_pos;
+}
+
+inline b32 rect2_contains(rect2 outer, rect2 inner)
 {
-    u32 vertice_index = ui->num_vertices;
+    b32 contains = (inner.min_pos.x >= outer.min_pos.x && inner.max_pos.x <= outer.max_pos.x &&
+                    inner.min_pos.y >= outer.min_pos.y && inner.max_pos.y <= outer.max_pos.y);
+    return contains;
+}
+
+inline b32 rect2_overlaps(rect2 a, rect2 b)
+{
+    b32 overlaps = (a.min_pos.x < b.max_pos.x && a.max_pos.x > b.min_pos.x &&
+                    a.min_pos.y < b.max_pos.y && a.max_pos.y > b.min_pos.y);
+    return overlaps;
+}
+
+static rect2 get_points_bounds(vec2 *points, u32 num_points)
+{
+    rect2 bounds = r2(points[0], points[0]);
+    for (u32 point_index = 1; point_index < num_points; ++point_index)
+    {
+        vec2 point = points[point_index];
+        bounds.min_pos.x = (point.x < bounds.min_pos.x) ? point.x : bounds.min_pos.x;
+        bounds.min_pos.y = (point.y < bounds.min_pos.y) ? point.y : bounds.min_pos.y;
+        bounds.max_pos.x = (point.x > bounds.max_pos.x) ? point.x : bounds.max_pos.x;
+        bounds.max_pos.y = (point.y > bounds.max_pos.y) ? point.y : bounds.max_pos.y;
+    }
+    return bounds;
+}
+
+// NOTE(dan): false when nothing is left, otherwise shrinks the quad to the clip rect and moves its uvs along
+static b32 clip_quad(rect2 clip_rect, vec2 *min_pos, vec2 *max_pos, vec2 *min_uv, vec2 *max_uv)
+{
+    b32 visible = rect2_overlaps(clip_rect, r2(*min_pos, *max_pos));
+    if (visible)
+    {
+        vec2 dim = vec2_sub(*max_pos, *min_pos);
+        vec2 uv_dim = vec2_sub(*max_uv, *min_uv);
+
+        for (u32 axis = 0; axis < 2; ++axis)
+        {
+            if (min_pos->e[axis] < clip_rect.min_pos.e[axis])
+            {
+                f32 t = (clip_rect.min_pos.e[axis] - min_pos->e[axis]) / dim.e[axis];
+                min_uv->e[axis] += t * uv_dim.e[axis];
+                min_pos->e[axis] = clip_rect.min_pos.e[axis];
+            }
+            if (max_pos->e[axis] > clip_rect.max_pos.e[axis])
+            {
+                f32 t = (max_pos->e[axis] - clip_rect.max_pos.e[axis]) / dim.e[axis];
+                max_uv->e[axis] -= t * uv_dim.e[axis];
+                max_pos->e[axis] = clip_rect.max_pos.e[axis];
+            }
+        }
+    }
+    return visible;
+}
+
+// NOTE(dan): sutherland hodgman against one edge, keeps the side where side * (pos - edge) >= 0
+static u32 clip_polygon_to_edge(vec2 *points, u32 num_points, vec2 *clipped_points, u32 axis, f32 edge, f32 side)
+{
+    u32 num_clipped_points = 0;
+    for (u32 point_index = 0; point_index < num_points; ++point_index)
+    {
+        vec2 a = points[point_index];
+        vec2 b = points[(point_index + 1) % num_points];
+        f32 a_distance = side * (a.e[axis] - edge);
+        f32 b_distance = side * (b.e[axis] - edge);
+
+        if (a_distance >= 0.0f)
+        {
+            clipped_points[num_clipped_points++] = a;
+        }
+        if ((a_distance >= 0.0f) != (b_distance >= 0.0f))
+        {
+            f32 t = a_distance / (a_distance - b_distance);
+            clipped_points[num_clipped_points++] = vec2_add(a, vec2_mul(t, vec2_sub(b, a)));
+        }
+    }
+    return num_clipped_points;
+}
+
+inline u32 lerp_color(u32 a, u32 b, f32 t)
+{
+    u32 color = 0;
+    for (u32 shift = 0; shift < 32; shift += 8)
+    {
+        f32 a_channel = (f32)((a >> shift) & 0xFF);
+        f32 b_channel = (f32)((b >> shift) & 0xFF);
+        u32 channel = (u32)(a_channel + t * (b_channel - a_channel) + 0.5f);
+
+        color |= channel << shift;
+    }
+    return color;
+}
+
+inline u32 bilerp_color(u32 top_left_color, u32 top_right_color, u32 bottom_left_color, u32 bottom_right_color, vec2 t)
+{
+    u32 top_color = lerp_color(top_left_color, top_right_color, t.x);
+    u32 bottom_color = lerp_color(bottom_left_color, bottom_right_color, t.x);
+    u32 color = lerp_color(top_color, bottom_color, t.y);
+    return color;
+}
+
+inline u32 push_quads(UIState *ui, u32 num_quads)
+{
+    b32 has_room = reserve_stream_room(ui, UploadCounter_Vertices, ui->num_vertices + num_quads * 4);
+    assert(has_room);
+
+    DrawCommand *command = get_draw_command(ui, DrawCommand_Quads, ui->num_vertices);
+    command->count += num_quads;
+
+    u32 first_vertex = ui->num_vertices;
+    ui->num_vertices += num_quads * 4;
+    return first_vertex;
+}
+
+inline QuadInstance *push_instance(UIState *ui)
+{
+    b32 has_room = reserve_stream_room(ui, UploadCounter_Instances, ui->num_instances + 1);
+    assert(has_room);
+
+    DrawCommand *command = get_draw_command(ui, DrawCommand_Instances, ui->num_instances);
+    ++command->count;
+
+    QuadInstance *instance = ui->instances + ui->num_instances++;
+    return instance;
+}
+
+inline void add_quad_instance(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, 
+                              vec2 top_left_corner_uv, vec2 bottom_right_corner_uv, u32 color, u32 texture_slot)
+{
+    QuadInstance *instance = push_instance(ui);
+    instance->min_pos = get_local_pos(ui, top_left_corner);
+    instance->size = vec2_sub(bottom_right_corner, top_left_corner);
+    instance->min_uv = top_left_corner_uv;
+    instance->max_uv = bottom_right_corner_uv;
+    instance->color = color;
+    instance->slot = texture_slot;
+}
+
+inline ShapeInstance *push_shape(UIState *ui)
+{
+    b32 has_room = reserve_stream_room(ui, UploadCounter_Shapes, ui->num_shapes + 1);
+    assert(has_room);
+
+    DrawCommand *command = get_draw_command(ui, DrawCommand_Shapes, ui->num_shapes);
+    ++command->count;
+
+    ShapeInstance *shape = ui->shapes + ui->num_shapes++;
+    return shape;
+}
+
+// NOTE(dan): a rounded rect, the border_width wide ring inside its edge when border_width is not 0, 
+//            softness blurs the edge over that many pixels
+static void add_shape(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, f32 radius, f32 border_width, f32 softness, u32 color)
+{
+    // NOTE(dan): the shader grows the quad by the softness and a pixel, then clamps it to the clip rect
+    f32 grow = softness + 1.0f;
+    rect2 bounds = r2(vec2_sub(top_left_corner, v2(grow, grow)), vec2_add(bottom_right_corner, v2(grow, grow)));
+
+    if (!ui->cpu_clipping || rect2_overlaps(ui->clip_rect, bounds))
+    {
+        vec2 size = vec2_sub(bottom_right_corner, top_left_corner);
+        f32 max_radius = 0.5f * ((size.x < size.y) ? size.x : size.y);
+
+        ShapeInstance *shape = push_shape(ui);
+        shape->min_pos = get_local_pos(ui, top_left_corner);
+        shape->size = size;
+        shape->radius = (radius < max_radius) ? radius : max_radius;
+        shape->border_width = border_width;
+        shape->softness = softness;
+        shape->color = color;
+        shape->clip_rect = r2(get_local_pos(ui, ui->clip_rect.min_pos), get_local_pos(ui, ui->clip_rect.max_pos));
+    }
+}
 
-    assert(ui->num_vertices + 4 < MAX_NUM_VERTICES);
-    assert(ui->num_elements + 6 < MAX_NUM_ELEMENTS);
+inline void add_rounded_rect_filled(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, f32 radius, u32 color)
+{
+    add_shape(ui, top_left_corner, bottom_right_corner, radius, 0.0f, 0.0f, color);
+}
 
-    Vertex *vertices = ui->vertices + ui->num_vertices;
-    GLuint *elements = ui->elements + ui->num_elements;
+inline void add_rounded_rect_outline(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, f32 radius, f32 thickness, u32 color)
+{
+    add_shape(ui, top_left_corner, bottom_right_corner, radius, thickness, 0.0f, color);
+}
 
-    vertices[0].pos = v2(top_left_corner.x, top_left_corner.y);
-    vertices[0].uv = v2(top_left_corner_uv.u, top_left_corner_uv.v);
-    vertices[0].color = color;
+inline void add_shadow(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, f32 radius, f32 softness, u32 color)
+{
+    add_shape(ui, top_left_corner, bottom_right_corner, radius, 0.0f, softness, color);
+}
 
-    vertices[1].pos = v2(top_left_corner.x, bottom_right_corner.y);
-    vertices[1].uv = v2(top_left_corner_uv.u, bottom_right_corner_uv.v);
-    vertices[1].color = color;
+// NOTE(dan): the corners of a quad are top left, bottom left, bottom right, top right
+inline void set_quad(AosVertexStreams *streams, u32 index, vec2 min_pos, vec2 max_pos, vec2 min_uv, vec2 max_uv,
+                     u32 top_left_color, u32 top_right_color, u32 bottom_left_color, u32 bottom_right_color, 
+                     u32 texture_slot = FONT_TEXTURE_SLOT)
+{
+    set_vertex(streams, index + 0, v2(min_pos.x, min_pos.y), v2(min_uv.u, min_uv.v), top_left_color, texture_slot);
+    set_vertex(streams, index + 1, v2(min_pos.x, max_pos.y), v2(min_uv.u, max_uv.v), bottom_left_color, texture_slot);
+    set_vertex(streams, index + 2, v2(max_pos.x, max_pos.y), v2(max_uv.u, max_uv.v), bottom_right_color, texture_slot);
+    set_vertex(streams, index + 3, v2(max_pos.x, min_pos.y), v2(max_uv.u, min_uv.v), top_right_color, texture_slot);
+}
 
-    vertices[2].pos = v2(bottom_right_corner.x, bottom_right_corner.y);
-    vertices[2].uv = v2(bottom_right_corner_uv.u, bottom_right_corner_uv.v);
-    vertices[2].color = color;
+inline void set_quad(SoaVertexStreams *streams, u32 index, vec2 min_pos, vec2 max_pos, vec2 min_uv, vec2 max_uv,
+                     u32 top_left_color, u32 top_right_color, u32 bottom_left_color, u32 bottom_right_color, 
+                     u32 texture_slot = FONT_TEXTURE_SLOT)
+{
+    // NOTE(dan): every attribute of the four corners is contiguous, so each stream takes one or two 16 byte stores
+    __m128 pos_0 = _mm_setr_ps(min_pos.x, min_pos.y, min_pos.x, max_pos.y);
+    __m128 pos_1 = _mm_setr_ps(max_pos.x, max_pos.y, max_pos.x, min_pos.y);
+    __m128 uv_0 = _mm_setr_ps(min_uv.u, min_uv.v, min_uv.u, max_uv.v);
+    __m128 uv_1 = _mm_setr_ps(max_uv.u, max_uv.v, max_uv.u, min_uv.v);
+    __m128i colors = _mm_setr_epi32((i32)top_left_color, (i32)bottom_left_color, (i32)bottom_right_color, (i32)top_right_color);
+
+    // NOTE(dan): same as get_vertex_u on the u lanes
+    f32 u_scale = (f32)VERTEX_U_MAX * (1.0f / 65535.0f);
+    f32 u_slot = (f32)(texture_slot << VERTEX_SLOT_SHIFT) * (1.0f / 65535.0f);
+    __m128 uv_slot_scale = _mm_setr_ps(u_scale, 1.0f, u_scale, 1.0f);
+    __m128 uv_slot_offset = _mm_setr_ps(u_slot, 0.0f, u_slot, 0.0f);
+    uv_0 = _mm_add_ps(_mm_mul_ps(uv_0, uv_slot_scale), uv_slot_offset);
+    uv_1 = _mm_add_ps(_mm_mul_ps(uv_1, uv_slot_scale), uv_slot_offset);
+
+#if GUI_COMPACT_VERTICES
+    assert((min_pos.x >= -VERTEX_POS_LIMIT) && (max_pos.x < VERTEX_POS_LIMIT));
+    assert((min_pos.y >= -VERTEX_POS_LIMIT) && (max_pos.y < VERTEX_POS_LIMIT));
+
+    // NOTE(dan): rounds half to even instead of up like pack_vertex_pos, the signed pack saturates like its clamp
+    __m128 pos_scale = _mm_set1_ps(VERTEX_POS_SCALE);
+    __m128i pos = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(pos_0, pos_scale)), 
+                                  _mm_cvtps_epi32(_mm_mul_ps(pos_1, pos_scale)));
+
+    // NOTE(dan): sse2 has no unsigned 32 to 16 bit pack, so bias into the signed range and flip the sign bits back
+    __m128 uv_scale = _mm_set1_ps(65535.0f);
+    __m128 uv_round = _mm_set1_ps(0.5f);
+    __m128i uv_bias = _mm_set1_epi32(32768);
+    __m128i uv_0_fixed = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(uv_0, uv_scale), uv_round)), uv_bias);
+    __m128i uv_1_fixed = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(uv_1, uv_scale), uv_round)), uv_bias);
+    __m128i uv = _mm_xor_si128(_mm_packs_epi32(uv_0_fixed, uv_1_fixed), _mm_set1_epi16(-32768));
+
+    _mm_storeu_si128((__m128i *)(streams->pos + index), pos);
+    _mm_storeu_si128((__m128i *)(streams->uv + index), uv);
+#else
+    _mm_storeu_ps(&streams->pos[index + 0].x, pos_0);
+    _mm_storeu_ps(&streams->pos[index + 2].x, pos_1);
+    _mm_storeu_ps(&streams->uv[index + 0].u, uv_0);
+    _mm_storeu_ps(&streams->uv[index + 2].u, uv_1);
+#endif
+
+    _mm_storeu_si128((__m128i *)(streams->color + index), colors);
+}
 
-    vertices[3].pos = v2(bottom_right_corner.x, top_left_corner.y);
-    vertices[3].uv = v2(bottom_right_corner_uv.u, top_left_corner_uv.v);
-    vertices[3].color = color;
+static void add_textured_quad(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, 
+                              vec2 top_left_corner_uv, vec2 bottom_right_corner_uv, u32 color, 
+                              u32 texture_slot = FONT_TEXTURE_SLOT)
+{
+    b32 visible = true;
+    if (ui->cpu_clipping)
+    {
+        visible = clip_quad(ui->clip_rect, &top_left_corner, &bottom_right_corner, &top_left_corner_uv, &bottom_right_corner_uv);
+    }
 
-    elements[0] = vertice_index + 0;
-    elements[1] = vertice_index + 1;
-    elements[2] = vertice_index + 2;
-    elements[3] = vertice_index + 0;
-    elements[4] = vertice_index + 2;
-    elements[5] = vertice_index + 3;
+    if (visible)
+    {
+        if (ui->use_instancing)
+        {
+            add_quad_instance(ui, top_left_corner, bottom_right_corner, top_left_corner_uv, bottom_right_corner_uv, color, texture_slot);
+        }
+        else
+        {
+            u32 vertex_index = push_quads(ui, 1);
+            set_quad(&ui->vertices, vertex_index, get_local_pos(ui, top_left_corner), get_local_pos(ui, bottom_right_corner), 
+                     top_left_corner_uv, bottom_right_corner_uv, color, color, color, color, texture_slot);
+        }
+    }
+}
 
-    ui->num_vertices += 4;
-    ui->num_elements += 6;
+// NOTE(dan): the texture has to be in a slot, see add_texture_slot, images from any slot batch with the rest of the ui
+inline void add_image(UIState *ui, u32 texture_slot, vec2 top_left_corner, vec2 bottom_right_corner, u32 color = 0xFFFFFFFF,
+                      vec2 top_left_corner_uv = v2(0.0f, 0.0f), vec2 bottom_right_corner_uv = v2(1.0f, 1.0f))
+{
+    add_textured_quad(ui, top_left_corner, bottom_right_corner, top_left_corner_uv, bottom_right_corner_uv, color, texture_slot);
 }
 
 static void add_color_quad(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, 
                            u32 top_left_color, u32 top_right_color,
                            u32 bottom_left_color, u32 bottom_right_color)
 {
-    u32 vertice_index = ui->num_vertices;
-    vec2 uv = ui->current_font.white_pixel_uv;
+    b32 visible = true;
+    if (ui->cpu_clipping)
+    {
+        // NOTE(dan): clip a unit uv rect along to know where the new corners are for the colors
+        vec2 min_t = v2(0.0f, 0.0f);
+        vec2 max_t = v2(1.0f, 1.0f);
+        visible = clip_quad(ui->clip_rect, &top_left_corner, &bottom_right_corner, &min_t, &max_t);
+
+        if (visible && (top_left_color != top_right_color || top_left_color != bottom_left_color || top_left_color != bottom_right_color))
+        {
+            u32 tl = top_left_color;
+            u32 tr = top_right_color;
+            u32 bl = bottom_left_color;
+            u32 br = bottom_right_color;
+
+            top_left_color     = bilerp_color(tl, tr, bl, br, min_t);
+            top_right_color    = bilerp_color(tl, tr, bl, br, v2(max_t.x, min_t.y));
+            bottom_left_color  = bilerp_color(tl, tr, bl, br, v2(min_t.x, max_t.y));
+            bottom_right_color = bilerp_color(tl, tr, bl, br, max_t);
+        }
+    }
+
+    if (visible)
+    {
+        vec2 uv = ui->current_font->white_pixel_uv;
+        u32 vertex_index = push_quads(ui, 1);
+        set_quad(&ui->vertices, vertex_index, get_local_pos(ui, top_left_corner), get_local_pos(ui, bottom_right_corner), uv, uv, 
+                 top_left_color, top_right_color, bottom_left_color, bottom_right_color);
+    }
+}
+
+// NOTE(dan): reserves the vertices of a convex polygon and writes its elements as a fan around the first vertex, 
+//            returns the index of the first vertex
+static u32 push_poly(UIState *ui, u32 num_vertices)
+{
+    u32 start_vertice_index = ui->num_vertices;
+    u32 num_elements = (num_vertices - 2) * 3;
+
+    b32 has_room = (reserve_stream_room(ui, UploadCounter_Vertices, ui->num_vertices + num_vertices) && 
+                    reserve_stream_room(ui, UploadCounter_Elements, ui->num_elements + num_elements));
+    assert(has_room);
+
+    DrawCommand *command = get_draw_command(ui, DrawCommand_Elements, ui->num_elements);
+    command->count += num_elements;
+
+    for (u32 element_index = 2; element_index < num_vertices; ++element_index)
+    {
+        GLuint *element = ui->elements + ui->num_elements;
+        element[0] = start_vertice_index;
+        element[1] = start_vertice_index + element_index - 1;
+        element[2] = start_vertice_index + element_index;
+
+        ui->num_elements += 3;
+    }
+
+    ui->num_vertices += num_vertices;
+    return start_vertice_index;
+}
+
+static void push_poly_filled(UIState *ui, vec2 *vertices, u32 num_vertices, u32 color)
+{
+    u32 start_vertice_index = push_poly(ui, num_vertices);
+    for (u32 vertex_index = 0; vertex_index < num_vertices; ++vertex_index)
+    {
+        set_vertex(&ui->vertices, start_vertice_index + vertex_index, get_local_pos(ui, vertices[vertex_index]), 
+                   ui->current_font->white_pixel_uv, color);
+    }
+}
+
+// NOTE(dan): the polygon has to be convex
+static void add_poly_filled(UIState *ui, vec2 *vertices, u32 num_vertices, u32 color)
+{
+    if (!ui->cpu_clipping)
+    {
+        push_poly_filled(ui, vertices, num_vertices, color);
+    }
+    else
+    {
+        rect2 clip_rect = ui->clip_rect;
+        rect2 bounds = get_points_bounds(vertices, num_vertices);
+
+        if (rect2_contains(clip_rect, bounds))
+        {
+            push_poly_filled(ui, vertices, num_vertices, color);
+        }
+        else if (rect2_overlaps(clip_rect, bounds))
+        {
+            TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
+            {
+                // NOTE(dan): every edge of the clip rect adds at most one point
+                u32 max_num_points = num_vertices + 4;
+                vec2 *points = push_array(&ui->memory, max_num_points, vec2, no_clear());
+                vec2 *clipped_points = push_array(&ui->memory, max_num_points, vec2, no_clear());
+
+                u32 num_points = clip_polygon_to_edge(vertices, num_vertices, clipped_points, 0, clip_rect.min_pos.x,  1.0f);
+                num_points = clip_polygon_to_edge(clipped_points, num_points, points, 0, clip_rect.max_pos.x, -1.0f);
+                num_points = clip_polygon_to_edge(points, num_points, clipped_points, 1, clip_rect.min_pos.y,  1.0f);
+                num_points = clip_polygon_to_edge(clipped_points, num_points, points, 1, clip_rect.max_pos.y, -1.0f);
+
+                if (num_points >= 3)
+                {
+                    push_poly_filled(ui, points, num_points, color);
+                }
+            }
+            end_temp_memory(temp_memory);
+        }
+    }
+}
+
+// NOTE(dan): the number of segments of a circle is the smallest divisor of the table size that keeps the distance 
+//            between the segments and the circle under CIRCLE_MAX_ERROR, that is r * (1 - cos(pi / n)) ~ r * pi^2 / (2 * n^2)
+static void init_circle_tables(UIState *ui)
+{
+    ui->circle_table = push_array(&ui->memory, CIRCLE_TABLE_SIZE, vec2, no_clear());
+    ui->circle_segment_counts = push_array(&ui->memory, MAX_CIRCLE_TABLE_RADIUS, u8, no_clear());
+
+    for (u32 point_index = 0; point_index < CIRCLE_TABLE_SIZE; ++point_index)
+    {
+        f32 angle = (f32)point_index * (TAU32 / CIRCLE_TABLE_SIZE);
+        ui->circle_table[point_index] = v2(cos32(angle), -sin32(angle));
+    }
+
+    for (u32 radius = 0; radius < MAX_CIRCLE_TABLE_RADIUS; ++radius)
+    {
+        f32 min_num_segments = PI32 * sqrt32((f32)radius / (2.0f * CIRCLE_MAX_ERROR));
+
+        u32 num_segments = MIN_CIRCLE_SEGMENTS;
+        while (num_segments < CIRCLE_TABLE_SIZE && ((f32)num_segments < min_num_segments || (CIRCLE_TABLE_SIZE % num_segments) != 0))
+        {
+            ++num_segments;
+        }
+        ui->circle_segment_counts[radius] = (u8)num_segments;
+    }
+}
+
+// NOTE(dan): the radius is clamped before the conversion, negative, nan or huge radii are undefined as a u32
+inline u32 get_circle_num_segments(UIState *ui, f32 radius)
+{
+    f32 clamped_radius = (radius > 0.0f) ? radius : 0.0f;
+    u32 radius_index = (clamped_radius < (f32)MAX_CIRCLE_TABLE_RADIUS) ? (u32)clamped_radius + 1 : MAX_CIRCLE_TABLE_RADIUS;
+    u32 num_segments = (radius_index < MAX_CIRCLE_TABLE_RADIUS) ? ui->circle_segment_counts[radius_index] : CIRCLE_TABLE_SIZE;
+    return num_segments;
+}
+
+inline vec2 get_circle_table_point(UIState *ui, vec2 center, f32 radius, i32 table_index)
+{
+    i32 point_index = table_index % CIRCLE_TABLE_SIZE;
+    if (point_index < 0)
+    {
+        point_index += CIRCLE_TABLE_SIZE;
+    }
+
+    vec2 point = vec2_add(center, vec2_mul(radius, ui->circle_table[point_index]));
+    return point;
+}
+
+#define POLYLINE_CHUNK_SIZE 256
+#define MITER_LIMIT 4.0f
+
+// NOTE(dan): a join or a cap with a round fan of at most half a circle, and the quad of the segment before it
+#define MAX_NUM_POLYLINE_POINT_VERTICES (5 + CIRCLE_TABLE_SIZE / 2)
+#define MAX_NUM_POLYLINE_POINT_ELEMENTS (3 * (MAX_NUM_POLYLINE_POINT_VERTICES + 4))
+
+// NOTE(dan): a triangle clipped to the clip rect is a fan of at most 7 new vertices and 5 triangles
+#define MAX_NUM_CLIPPED_POLYLINE_POINT_VERTICES (MAX_NUM_POLYLINE_POINT_VERTICES + 7 * (MAX_NUM_POLYLINE_POINT_ELEMENTS / 3))
+#define MAX_NUM_CLIPPED_POLYLINE_POINT_ELEMENTS (5 * MAX_NUM_POLYLINE_POINT_ELEMENTS)
+
+// NOTE(dan): the position is kept so triangles can be clipped without reading the vertex back from the stream
+struct PolylineVertex
+{
+    u32 index;
+    vec2 pos;
+};
+
+// NOTE(dan): on the left of the direction of the segment, zero for segments without length
+inline vec2 get_segment_normal(vec2 from, vec2 to)
+{
+    vec2 delta = vec2_sub(to, from);
+    f32 length2 = vec2_length2(delta);
+
+    vec2 normal = v2(0.0f, 0.0f);
+    if (length2 > 1e-12f)
+    {
+        f32 inv_length = 1.0f / _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(length2)));
+        normal = v2(delta.y * inv_length, -delta.x * inv_length);
+    }
+    return normal;
+}
+
+static void calc_segment_normals(vec2 *points, u32 num_segments, vec2 *normals)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 min_length2 = _mm_set1_ps(1e-12f);
+
+    // NOTE(dan): four segments at a time, the five points they span are split into x and y lanes
+    u32 segment_index = 0;
+    for (; segment_index + 4 <= num_segments; segment_index += 4)
+    {
+        f32 *at = &points[segment_index].x;
+        __m128 points_01 = _mm_loadu_ps(at + 0);
+        __m128 points_23 = _mm_loadu_ps(at + 4);
+        __m128 points_12 = _mm_loadu_ps(at + 2);
+        __m128 points_34 = _mm_loadu_ps(at + 6);
+
+        __m128 delta_x = _mm_sub_ps(_mm_shuffle_ps(points_12, points_34, _MM_SHUFFLE(2, 0, 2, 0)), 
+                                    _mm_shuffle_ps(points_01, points_23, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128 delta_y = _mm_sub_ps(_mm_shuffle_ps(points_12, points_34, _MM_SHUFFLE(3, 1, 3, 1)), 
+                                    _mm_shuffle_ps(points_01, points_23, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        __m128 length2 = _mm_add_ps(_mm_mul_ps(delta_x, delta_x), _mm_mul_ps(delta_y, delta_y));
+        __m128 inv_length = _mm_and_ps(_mm_cmpgt_ps(length2, min_length2), _mm_div_ps(one, _mm_sqrt_ps(length2)));
+
+        __m128 normal_x = _mm_mul_ps(delta_y, inv_length);
+        __m128 normal_y = _mm_sub_ps(zero, _mm_mul_ps(delta_x, inv_length));
+
+        _mm_storeu_ps(&normals[segment_index + 0].x, _mm_unpacklo_ps(normal_x, normal_y));
+        _mm_storeu_ps(&normals[segment_index + 2].x, _mm_unpackhi_ps(normal_x, normal_y));
+    }
+
+    for (; segment_index < num_segments; ++segment_index)
+    {
+        normals[segment_index] = get_segment_normal(points[segment_index], points[segment_index + 1]);
+    }
+}
+
+inline PolylineVertex push_polyline_vertex(UIState *ui, vec2 pos, vec2 uv, u32 color)
+{
+    PolylineVertex vertex;
+    vertex.index = ui->num_vertices++;
+    vertex.pos = pos;
+    set_vertex(&ui->vertices, vertex.index, get_local_pos(ui, pos), uv, color);
+    return vertex;
+}
+
+inline void push_triangle_elements(UIState *ui, u32 a, u32 b, u32 c)
+{
+    GLuint *element = ui->elements + ui->num_elements;
+    element[0] = a;
+    element[1] = b;
+    element[2] = c;
+
+    ui->num_elements += 3;
+}
 
-    assert(ui->num_vertices + 4 < MAX_NUM_VERTICES);
-    assert(ui->num_elements + 6 < MAX_NUM_ELEMENTS);
+// NOTE(dan): triangles that cross the clip rect are clipped into a fan of new vertices, the ones outside are dropped
+static void push_triangle(UIState *ui, PolylineVertex a, PolylineVertex b, PolylineVertex c, b32 clipped, vec2 uv, u32 color)
+{
+    vec2 points[3 + 4] = {a.pos, b.pos, c.pos};
+    rect2 bounds = clipped ? get_points_bounds(points, 3) : ui->clip_rect;
+
+    if (!clipped || rect2_contains(ui->clip_rect, bounds))
+    {
+        push_triangle_elements(ui, a.index, b.index, c.index);
+    }
+    else if (rect2_overlaps(ui->clip_rect, bounds))
+    {
+        rect2 clip_rect = ui->clip_rect;
+        vec2 clipped_points[3 + 4];
+
+        u32 num_points = clip_polygon_to_edge(points, 3, clipped_points, 0, clip_rect.min_pos.x,  1.0f);
+        num_points = clip_polygon_to_edge(clipped_points, num_points, points, 0, clip_rect.max_pos.x, -1.0f);
+        num_points = clip_polygon_to_edge(points, num_points, clipped_points, 1, clip_rect.min_pos.y,  1.0f);
+        num_points = clip_polygon_to_edge(clipped_points, num_points, points, 1, clip_rect.max_pos.y, -1.0f);
+
+        if (num_points >= 3)
+        {
+            u32 first_vertex = ui->num_vertices;
+            for (u32 point_index = 0; point_index < num_points; ++point_index)
+            {
+                push_polyline_vertex(ui, points[point_index], uv, color);
+            }
+            for (u32 point_index = 1; point_index + 1 < num_points; ++point_index)
+            {
+                push_triangle_elements(ui, first_vertex, first_vertex + point_index, first_vertex + point_index + 1);
+            }
+        }
+    }
+}
+
+// NOTE(dan): turns offset around pos by angle, the triangles fan out from center_vertex
+static void push_round_fan(UIState *ui, vec2 pos, vec2 offset, f32 angle, f32 radius, PolylineVertex center_vertex, 
+                           PolylineVertex first_vertex, PolylineVertex last_vertex, b32 clipped, vec2 uv, u32 color)
+{
+    f32 abs_angle = abs32(angle);
+    u32 num_steps = (u32)(abs_angle * (f32)get_circle_num_segments(ui, radius) / TAU32) + 1;
+
+    f32 step_angle = abs_angle / (f32)num_steps;
+    f32 step_cos = cos32(step_angle);
+    f32 step_sin = (angle < 0.0f) ? -sin32(step_angle) : sin32(step_angle);
+
+    PolylineVertex prev_vertex = first_vertex;
+    for (u32 step_index = 1; step_index < num_steps; ++step_index)
+    {
+        offset = v2(offset.x * step_cos - offset.y * step_sin, offset.x * step_sin + offset.y * step_cos);
+
+        PolylineVertex vertex = push_polyline_vertex(ui, vec2_add(pos, offset), uv, color);
+        push_triangle(ui, center_vertex, prev_vertex, vertex, clipped, uv, color);
+        prev_vertex = vertex;
+    }
+    push_triangle(ui, center_vertex, prev_vertex, last_vertex, clipped, uv, color);
+}
+
+// NOTE(dan): every point has the vertices where the segment before it ends and the one after it starts, shared 
+//            between the two with miter joins, bevel and round joins add a triangle or a fan on the outer side. 
+//            Normals are calculated in chunks, so there is no limit on the number of points, the line stops where 
+//            the streams are full. With cpu clipping the triangles that cross the clip rect are clipped one by one.
+static void add_polyline(UIState *ui, vec2 *points, u32 num_points, u32 color, f32 thickness, b32 closed, 
+                         LineJoin join = LineJoin_Miter, LineCap cap = LineCap_Butt)
+{
+    f32 half_thickness = 0.5f * thickness;
+
+    b32 visible = (num_points >= 2);
+    b32 clipped = false;
+    if (visible && ui->cpu_clipping)
+    {
+        f32 grow = half_thickness * MITER_LIMIT;
+        rect2 bounds = get_points_bounds(points, num_points);
+        bounds = r2(vec2_sub(bounds.min_pos, v2(grow, grow)), vec2_add(bounds.max_pos, v2(grow, grow)));
+
+        visible = rect2_overlaps(ui->clip_rect, bounds);
+        clipped = !rect2_contains(ui->clip_rect, bounds);
+    }
+
+    if (visible)
+    {
+        vec2 uv = ui->current_font->white_pixel_uv;
+        u32 first_element = ui->num_elements;
+        u32 max_point_vertices = clipped ? MAX_NUM_CLIPPED_POLYLINE_POINT_VERTICES : MAX_NUM_POLYLINE_POINT_VERTICES;
+        u32 max_point_elements = clipped ? MAX_NUM_CLIPPED_POLYLINE_POINT_ELEMENTS : MAX_NUM_POLYLINE_POINT_ELEMENTS;
+
+        vec2 normals[POLYLINE_CHUNK_SIZE];
+        u32 chunk_begin = 0;
+        u32 chunk_end = 0;
+
+        vec2 closing_normal = closed ? get_segment_normal(points[num_points - 1], points[0]) : v2(0.0f, 0.0f);
+        vec2 prev_normal = closing_normal;
+
+        PolylineVertex start_left = {0};
+        PolylineVertex start_right = {0};
+        PolylineVertex first_end_left = {0};
+        PolylineVertex first_end_right = {0};
+
+        b32 has_room = true;
+        for (u32 point_index = 0; has_room && point_index < num_points; ++point_index)
+        {
+            has_room = (reserve_stream_room(ui, UploadCounter_Vertices, ui->num_vertices + max_point_vertices) && 
+                        reserve_stream_room(ui, UploadCounter_Elements, ui->num_elements + max_point_elements));
+            if (has_room)
+            {
+                // NOTE(dan): the normal of the segment that starts at this point, segments without length go on like the one before
+                vec2 normal = closed ? closing_normal : prev_normal;
+                if (point_index + 1 < num_points)
+                {
+                    if (point_index >= chunk_end)
+                    {
+                        chunk_begin = point_index;
+                        chunk_end = min(point_index + POLYLINE_CHUNK_SIZE, num_points - 1);
+                        calc_segment_normals(points + chunk_begin, chunk_end - chunk_begin, normals);
+                    }
+                    normal = normals[point_index - chunk_begin];
+                }
+                if (normal.x == 0.0f && normal.y == 0.0f)
+                {
+                    normal = prev_normal;
+                }
+
+                vec2 pos = points[point_index];
+                PolylineVertex prev_start_left = start_left;
+                PolylineVertex prev_start_right = start_right;
+                PolylineVertex end_left = {0};
+                PolylineVertex end_right = {0};
+
+                b32 first_point = (point_index == 0);
+                b32 last_point = (point_index + 1 == num_points);
+                if (!closed && (first_point || last_point))
+                {
+                    vec2 cap_normal = first_point ? normal : prev_normal;
+                    vec2 offset = vec2_mul(half_thickness, cap_normal);
+
+                    // NOTE(dan): square caps stick out by half the thickness, round caps turn through the outside
+                    vec2 cap_pos = pos;
+                    if (cap == LineCap_Square)
+                    {
+                        vec2 direction = v2(-offset.y, offset.x);
+                        cap_pos = first_point ? vec2_sub(pos, direction) : vec2_add(pos, direction);
+                    }
+
+                    end_left = push_polyline_vertex(ui, vec2_add(cap_pos, offset), uv, color);
+                    end_right = push_polyline_vertex(ui, vec2_sub(cap_pos, offset), uv, color);
+                    start_left = first_point ? end_left : start_left;
+                    start_right = first_point ? end_right : start_right;
+
+                    if (cap == LineCap_Round)
+                    {
+                        PolylineVertex center_vertex = push_polyline_vertex(ui, pos, uv, color);
+                        push_round_fan(ui, pos, offset, first_point ? -PI32 : PI32, half_thickness, 
+                                       center_vertex, end_left, end_right, clipped, uv, color);
+                    }
+                }
+                else
+                {
+                    // NOTE(dan): the miter reaches the intersection of the offset edges, for a turn of theta it is 
+                    //            half_thickness / cos(theta / 2) long
+                    vec2 normal_sum = vec2_add(prev_normal, normal);
+                    f32 cos_theta = prev_normal.x * normal.x + prev_normal.y * normal.y;
+                    f32 cos_theta_plus_one = 1.0f + cos_theta;
+
+                    vec2 miter = v2(0.0f, 0.0f);
+                    if (cos_theta_plus_one > 1e-4f)
+                    {
+                        miter = vec2_mul(half_thickness / cos_theta_plus_one, normal_sum);
+                    }
+
+                    b32 straight = (cos_theta > 0.9999f);
+                    b32 within_limit = (cos_theta_plus_one >= 2.0f / (MITER_LIMIT * MITER_LIMIT));
+                    if (straight || (join == LineJoin_Miter && within_limit))
+                    {
+                        end_left = push_polyline_vertex(ui, vec2_add(pos, miter), uv, color);
+                        end_right = push_polyline_vertex(ui, vec2_sub(pos, miter), uv, color);
+                        start_left = end_left;
+                        start_right = end_right;
+                    }
+                    else
+                    {
+                        // NOTE(dan): the outer side is the left one when the line turns to the right
+                        f32 cross = prev_normal.x * normal.y - prev_normal.y * normal.x;
+                        f32 side = (cross > 0.0f) ? 1.0f : -1.0f;
+                        vec2 outer_offset_0 = vec2_mul(side * half_thickness, prev_normal);
+                        vec2 outer_offset_1 = vec2_mul(side * half_thickness, normal);
+
+                        PolylineVertex inner_vertex = push_polyline_vertex(ui, vec2_sub(pos, vec2_mul(side, miter)), uv, color);
+                        PolylineVertex outer_vertex_0 = push_polyline_vertex(ui, vec2_add(pos, outer_offset_0), uv, color);
+                        PolylineVertex outer_vertex_1 = push_polyline_vertex(ui, vec2_add(pos, outer_offset_1), uv, color);
+
+                        if (join == LineJoin_Round)
+                        {
+                            f32 theta = acos32((cos_theta < -1.0f) ? -1.0f : cos_theta);
+                            push_round_fan(ui, pos, outer_offset_0, (cross > 0.0f) ? theta : -theta, half_thickness, 
+                                           inner_vertex, outer_vertex_0, outer_vertex_1, clipped, uv, color);
+                        }
+                        else
+                        {
+                            push_triangle(ui, inner_vertex, outer_vertex_0, outer_vertex_1, clipped, uv, color);
+                        }
+
+                        end_left = (side > 0.0f) ? outer_vertex_0 : inner_vertex;
+                        end_right = (side > 0.0f) ? inner_vertex : outer_vertex_0;
+                        start_left = (side > 0.0f) ? outer_vertex_1 : inner_vertex;
+                        start_right = (side > 0.0f) ? inner_vertex : outer_vertex_1;
+                    }
+                }
+
+                if (first_point)
+                {
+                    first_end_left = end_left;
+                    first_end_right = end_right;
+                }
+                else
+                {
+                    push_triangle(ui, prev_start_left, end_left, end_right, clipped, uv, color);
+                    push_triangle(ui, prev_start_left, end_right, prev_start_right, clipped, uv, color);
+                }
+                prev_normal = normal;
+            }
+        }
+
+        if (closed && has_room)
+        {
+            push_triangle(ui, start_left, first_end_left, first_end_right, clipped, uv, color);
+            push_triangle(ui, start_left, first_end_right, start_right, clipped, uv, color);
+        }
+
+        // NOTE(dan): only once something was emitted, full streams or a line clipped away leave no empty command
+        if (ui->num_elements > first_element)
+        {
+            DrawCommand *command = get_draw_command(ui, DrawCommand_Elements, first_element);
+            command->count += ui->num_elements - first_element;
+        }
+    }
+}
+
+static void add_poly_outline(UIState *ui, vec2 *points, u32 point_count, u32 color, f32 thickness, b32 connect_last_with_first)
+{
+    add_polyline(ui, points, point_count, color, thickness, connect_last_with_first);
+}
+
+static void add_rect_outline(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, u32 color)
+{
+    top_left_corner = vec2_add(top_left_corner, v2(0.5f, 0.5f));
+    bottom_right_corner = vec2_sub(bottom_right_corner, v2(0.5f, 0.5f));
+    vec2 vertices[] =
+    {
+        v2(top_left_corner.x, top_left_corner.y),
+        v2(top_left_corner.x, bottom_right_corner.y),
+        v2(bottom_right_corner.x, bottom_right_corner.y),
+        v2(bottom_right_corner.x, top_left_corner.y),
+    };
+    add_poly_outline(ui, vertices, array_count(vertices), color, 1.0f, true);
+}
+
+inline void add_rect_filled(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, u32 color)
+{
+    vec2 uv = ui->current_font->white_pixel_uv;
+    add_textured_quad(ui, top_left_corner, bottom_right_corner, uv, uv, color);
+}
+
+#define MAX_NUM_ARC_POINTS (CIRCLE_TABLE_SIZE + 2)
+
+// NOTE(dan): full circles are the points of the table, arcs have exact ends with the points of the table between them, 
+//            num_segments is for the full circle and is rounded up to a divisor of the table size, 0 picks it from the radius
+static void add_arc_filled(UIState *ui, vec2 center, f32 radius, u32 color, f32 start_angle, f32 end_angle, u32 num_segments = 0)
+{
+    if (!num_segments)
+    {
+        num_segments = get_circle_num_segments(ui, radius);
+    }
+    while (num_segments < CIRCLE_TABLE_SIZE && (CIRCLE_TABLE_SIZE % num_segments) != 0)
+    {
+        ++num_segments;
+    }
+    num_segments = min(num_segments, CIRCLE_TABLE_SIZE);
+
+    i32 step = CIRCLE_TABLE_SIZE / (i32)num_segments;
+    b32 full_circle = (end_angle - start_angle >= TAU32);
+
+    i32 first_segment = 0;
+    u32 num_points = num_segments;
+    if (!full_circle)
+    {
+        // NOTE(dan): the table points strictly between the ends
+        f32 segments_per_radian = (f32)num_segments / TAU32;
+        f32 start_segment = start_angle * segments_per_radian;
+        f32 end_segment = end_angle * segments_per_radian;
+
+        first_segment = floor32(start_segment) + 1;
+        i32 last_segment = floor32(end_segment);
+        if ((f32)last_segment == end_segment)
+        {
+            --last_segment;
+        }
+
+        num_points = 2 + ((last_segment >= first_segment) ? (u32)(last_segment - first_segment + 1) : 0);
+    }
+
+    vec2 clipped_points[MAX_NUM_ARC_POINTS];
+    vec2 *points = 0;
+    u32 first_vertex = 0;
+
+    b32 visible = (num_points >= 3);
+    if (visible && ui->cpu_clipping && !rect2_contains(ui->clip_rect, r2(v2(center.x - radius, center.y - radius), v2(center.x + radius, center.y + radius))))
+    {
+        points = clipped_points;
+    }
+    else if (visible)
+    {
+        first_vertex = push_poly(ui, num_points);
+    }
+
+    if (visible)
+    {
+        vec2 uv = ui->current_font->white_pixel_uv;
+        for (u32 point_index = 0; point_index < num_points; ++point_index)
+        {
+            vec2 point;
+            if (full_circle)
+            {
+                point = get_circle_table_point(ui, center, radius, (i32)point_index * step);
+            }
+            else if (point_index == 0)
+            {
+                point = v2(center.x + cos32(start_angle) * radius, center.y - sin32(start_angle) * radius);
+            }
+            else if (point_index == num_points - 1)
+            {
+                point = v2(center.x + cos32(end_angle) * radius, center.y - sin32(end_angle) * radius);
+            }
+            else
+            {
+                point = get_circle_table_point(ui, center, radius, (first_segment + (i32)point_index - 1) * step);
+            }
+
+            if (points)
+            {
+                points[point_index] = point;
+            }
+            else
+            {
+                set_vertex(&ui->vertices, first_vertex + point_index, get_local_pos(ui, point), uv, color);
+            }
+        }
+
+        if (points)
+        {
+            add_poly_filled(ui, points, num_points, color);
+        }
+    }
+}
+
+inline void add_circle_filled(UIState *ui, vec2 center, f32 radius, u32 color)
+{
+    if (ui->use_instancing)
+    {
+        vec2 top_left_corner = v2(center.x - radius, center.y - radius);
+        vec2 bottom_right_corner = v2(center.x + radius, center.y + radius);
+        add_shape(ui, top_left_corner, bottom_right_corner, radius, 0.0f, 0.0f, color);
+    }
+    else
+    {
+        add_arc_filled(ui, center, radius, color, 0.0f, TAU32);
+    }
+}
+
+// NOTE(dan): path coordinates are multiplied by scale and moved by offset, the flattened path only depends on the scale
+inline void begin_path(UIState *ui, vec2 offset = v2(0.0f, 0.0f), f32 scale = 1.0f)
+{
+    ui->path_offset = offset;
+    ui->path_scale = scale;
+    ui->num_path_commands = 0;
+}
+
+static PathCommand *push_path_command(UIState *ui, PathCommandType type)
+{
+    assert(ui->num_path_commands < MAX_NUM_PATH_COMMANDS);
+
+    // NOTE(dan): cleared, the commands are hashed
+    PathCommand *command = ui->path_commands + ui->num_path_commands++;
+    zero_size(command, sizeof(PathCommand));
+    command->type = type;
+    return command;
+}
+
+inline void path_move_to(UIState *ui, vec2 pos)
+{
+    PathCommand *command = push_path_command(ui, PathCommand_MoveTo);
+    command->points[0] = pos;
+}
+
+inline void path_line_to(UIState *ui, vec2 pos)
+{
+    PathCommand *command = push_path_command(ui, PathCommand_LineTo);
+    command->points[0] = pos;
+}
+
+inline void path_quad_to(UIState *ui, vec2 control, vec2 pos)
+{
+    PathCommand *command = push_path_command(ui, PathCommand_QuadTo);
+    command->points[0] = control;
+    command->points[1] = pos;
+}
+
+inline void path_cubic_to(UIState *ui, vec2 control_0, vec2 control_1, vec2 pos)
+{
+    PathCommand *command = push_path_command(ui, PathCommand_CubicTo);
+    command->points[0] = control_0;
+    command->points[1] = control_1;
+    command->points[2] = pos;
+}
+
+// NOTE(dan): angles like add_arc_filled, connected to the current point with a line
+inline void path_arc_to(UIState *ui, vec2 center, f32 radius, f32 start_angle, f32 end_angle)
+{
+    PathCommand *command = push_path_command(ui, PathCommand_ArcTo);
+    command->points[0] = center;
+    command->radius = radius;
+    command->start_angle = start_angle;
+    command->end_angle = end_angle;
+}
+
+inline void path_close(UIState *ui)
+{
+    push_path_command(ui, PathCommand_Close);
+}
+
+#define PATH_TOLERANCE 0.25f
+#define MAX_PATH_SUBDIVISIONS 10
+
+// NOTE(dan): splits the curve in half until the control points are within the tolerance of the chord
+static void flatten_cubic(vec2 *points, u32 *num_points, vec2 p0, vec2 p1, vec2 p2, vec2 p3, u32 level)
+{
+    f32 dx = p3.x - p0.x;
+    f32 dy = p3.y - p0.y;
+    f32 d1 = abs32((p1.x - p3.x) * dy - (p1.y - p3.y) * dx);
+    f32 d2 = abs32((p2.x - p3.x) * dy - (p2.y - p3.y) * dx);
+
+    b32 flat = ((d1 + d2) * (d1 + d2) < PATH_TOLERANCE * PATH_TOLERANCE * (dx * dx + dy * dy));
+    if (flat || level >= MAX_PATH_SUBDIVISIONS)
+    {
+        points[(*num_points)++] = p3;
+    }
+    else
+    {
+        vec2 p01 = vec2_mul(0.5f, vec2_add(p0, p1));
+        vec2 p12 = vec2_mul(0.5f, vec2_add(p1, p2));
+        vec2 p23 = vec2_mul(0.5f, vec2_add(p2, p3));
+        vec2 p012 = vec2_mul(0.5f, vec2_add(p01, p12));
+        vec2 p123 = vec2_mul(0.5f, vec2_add(p12, p23));
+        vec2 p0123 = vec2_mul(0.5f, vec2_add(p012, p123));
+
+        flatten_cubic(points, num_points, p0, p01, p012, p0123, level + 1);
+        flatten_cubic(points, num_points, p0123, p123, p23, p3, level + 1);
+    }
+}
+
+inline PathSubpath *begin_subpath(PathSubpath *subpaths, u32 *num_subpaths, u32 first_point)
+{
+    PathSubpath *subpath = subpaths + (*num_subpaths)++;
+    subpath->first_point = first_point;
+    subpath->num_points = 0;
+    subpath->closed = false;
+    return subpath;
+}
+
+// NOTE(dan): flattens the commands at the path scale into points and subpaths, at most as many as get_max_flattened_points
+static void flatten_path(UIState *ui, vec2 *points, u32 *num_points, PathSubpath *subpaths, u32 *num_subpaths)
+{
+    f32 scale = ui->path_scale;
+    PathSubpath *subpath = 0;
+    vec2 pos = v2(0.0f, 0.0f);
+
+    for (u32 command_index = 0; command_index < ui->num_path_commands; ++command_index)
+    {
+        PathCommand *command = ui->path_commands + command_index;
+        vec2 p0 = vec2_mul(scale, command->points[0]);
+        vec2 p1 = vec2_mul(scale, command->points[1]);
+        vec2 p2 = vec2_mul(scale, command->points[2]);
+
+        // NOTE(dan): drawing without a move starts where the last subpath ended
+        if (command->type == PathCommand_MoveTo || !subpath || subpath->closed)
+        {
+            subpath = begin_subpath(subpaths, num_subpaths, *num_points);
+            if (command->type != PathCommand_ArcTo)
+            {
+                points[(*num_points)++] = (command->type == PathCommand_MoveTo) ? p0 : pos;
+            }
+        }
+
+        switch (command->type)
+        {
+            case PathCommand_MoveTo:
+            {
+                pos = p0;
+            } break;
+
+            case PathCommand_LineTo:
+            {
+                points[(*num_points)++] = p0;
+                pos = p0;
+            } break;
+
+            case PathCommand_QuadTo:
+            {
+                // NOTE(dan): as a cubic with the control points two thirds of the way to the quadratic one
+                vec2 control_0 = vec2_add(pos, vec2_mul(2.0f / 3.0f, vec2_sub(p0, pos)));
+                vec2 control_1 = vec2_add(p1, vec2_mul(2.0f / 3.0f, vec2_sub(p0, p1)));
+                flatten_cubic(points, num_points, pos, control_0, control_1, p1, 0);
+                pos = p1;
+            } break;
+
+            case PathCommand_CubicTo:
+            {
+                flatten_cubic(points, num_points, pos, p0, p1, p2, 0);
+                pos = p2;
+            } break;
+
+            case PathCommand_ArcTo:
+            {
+                f32 radius = scale * command->radius;
+                f32 angle = command->end_angle - command->start_angle;
+                f32 abs_angle = abs32(angle);
+                if (abs_angle > TAU32)
+                {
+                    abs_angle = TAU32;
+                    angle = (angle < 0.0f) ? -TAU32 : TAU32;
+                }
+
+                u32 num_steps = (u32)(abs_angle * (f32)get_circle_num_segments(ui, radius) / TAU32) + 1;
+                for (u32 step_index = 0; step_index <= num_steps; ++step_index)
+                {
+                    f32 step_angle = command->start_angle + angle * ((f32)step_index / (f32)num_steps);
+                    pos = v2(p0.x + cos32(step_angle) * radius, p0.y - sin32(step_angle) * radius);
+                    points[(*num_points)++] = pos;
+                }
+            } break;
+
+            case PathCommand_Close:
+            {
+                // NOTE(dan): the first point is not repeated, closed subpaths connect back to it
+                PathSubpath *closing = subpath;
+                u32 num_subpath_points = *num_points - closing->first_point;
+                if (num_subpath_points > 1)
+                {
+                    vec2 first = points[closing->first_point];
+                    vec2 last = points[*num_points - 1];
+                    if (first.x == last.x && first.y == last.y)
+                    {
+                        --(*num_points);
+                    }
+                }
+                closing->closed = true;
+                pos = points[closing->first_point];
+            } break;
+
+            invalid_default_case;
+        }
+
+        subpath->num_points = *num_points - subpath->first_point;
+    }
+}
+
+inline u32 get_max_flattened_points(UIState *ui)
+{
+    u32 max_num_points = 0;
+    for (u32 command_index = 0; command_index < ui->num_path_commands; ++command_index)
+    {
+        PathCommand *command = ui->path_commands + command_index;
+
+        // NOTE(dan): every command can start a subpath with one point
+        max_num_points += 1;
+        if (command->type == PathCommand_QuadTo || command->type == PathCommand_CubicTo)
+        {
+            max_num_points += 1 << MAX_PATH_SUBDIVISIONS;
+        }
+        else if (command->type == PathCommand_ArcTo)
+        {
+            max_num_points += CIRCLE_TABLE_SIZE + 2;
+        }
+        else
+        {
+            max_num_points += 1;
+        }
+    }
+    return max_num_points;
+}
+
+// NOTE(dan): flattened paths are looked up by the hash of their commands and the scale, a path that was used last frame 
+//            is copied into this frame's geometry stack, older ones are flattened again
+static FlattenedPath *get_flattened_path(UIState *ui)
+{
+    u64 key = hash_words(FNV_HASH_SEED, ui->path_commands, ui->num_path_commands * sizeof(PathCommand));
+    key = hash_words(key, &ui->path_scale, sizeof(ui->path_scale));
+
+    FlattenedPath *path = 0;
+    FlattenedPath *free_path = 0;
+    FlattenedPath *oldest_path = 0;
+    for (u32 probe_index = 0; !path && probe_index < 8; ++probe_index)
+    {
+        FlattenedPath *test_path = ui->path_cache + ((key + probe_index) & (PATH_CACHE_SIZE - 1));
+        b32 alive = (test_path->frame_index + 1 >= ui->frame_index && test_path->points);
+        if (alive && test_path->key == key)
+        {
+            path = test_path;
+        }
+        else if (!alive && !free_path)
+        {
+            free_path = test_path;
+        }
+
+        if (!oldest_path || test_path->frame_index < oldest_path->frame_index)
+        {
+            oldest_path = test_path;
+        }
+    }
+
+    MemoryStack *memory = ui->geometry_memory + ui->geometry_memory_index;
+    if (path && path->frame_index != ui->frame_index)
+    {
+        vec2 *points = push_array(memory, path->num_points, vec2, no_clear());
+        PathSubpath *subpaths = push_array(memory, path->num_subpaths, PathSubpath, no_clear());
+        copy_memory(points, path->points, path->num_points * sizeof(vec2));
+        copy_memory(subpaths, path->subpaths, path->num_subpaths * sizeof(PathSubpath));
+
+        path->points = points;
+        path->subpaths = subpaths;
+        path->frame_index = ui->frame_index;
+    }
+    else if (!path)
+    {
+        // NOTE(dan): every probe is taken by a live path, the one drawn longest ago is reused and the path it had is not 
+        //            cached anymore, a path drawn last frame goes before one that was already drawn in this frame
+        path = free_path ? free_path : oldest_path;
+
+        TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
+        {
+            u32 max_num_points = get_max_flattened_points(ui);
+            vec2 *points = push_array(&ui->memory, max_num_points, vec2, no_clear());
+            PathSubpath *subpaths = push_array(&ui->memory, ui->num_path_commands, PathSubpath, no_clear());
+
+            u32 num_points = 0;
+            u32 num_subpaths = 0;
+            flatten_path(ui, points, &num_points, subpaths, &num_subpaths);
+            assert(num_points <= max_num_points);
+
+            path->key = key;
+            path->frame_index = ui->frame_index;
+            path->num_points = num_points;
+            path->num_subpaths = num_subpaths;
+            path->points = push_array(memory, num_points, vec2, no_clear());
+            path->subpaths = push_array(memory, num_subpaths, PathSubpath, no_clear());
+            copy_memory(path->points, points, num_points * sizeof(vec2));
+            copy_memory(path->subpaths, subpaths, num_subpaths * sizeof(PathSubpath));
+        }
+        end_temp_memory(temp_memory);
+    }
+    return path;
+}
+
+// NOTE(dan): moves the points of a subpath by the path offset, the caller owns the temp memory
+static vec2 *get_subpath_points(UIState *ui, FlattenedPath *path, PathSubpath *subpath)
+{
+    vec2 *points = push_array(&ui->memory, subpath->num_points, vec2, no_clear());
+    for (u32 point_index = 0; point_index < subpath->num_points; ++point_index)
+    {
+        points[point_index] = vec2_add(path->points[subpath->first_point + point_index], ui->path_offset);
+    }
+    return points;
+}
+
+// NOTE(dan): every subpath is filled as a convex polygon, like add_poly_filled
+static void fill_path(UIState *ui, u32 color)
+{
+    FlattenedPath *path = get_flattened_path(ui);
+    for (u32 subpath_index = 0; subpath_index < path->num_subpaths; ++subpath_index)
+    {
+        PathSubpath *subpath = path->subpaths + subpath_index;
+        if (subpath->num_points >= 3)
+        {
+            TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
+            add_poly_filled(ui, get_subpath_points(ui, path, subpath), subpath->num_points, color);
+            end_temp_memory(temp_memory);
+        }
+    }
+}
+
+static void stroke_path(UIState *ui, u32 color, f32 thickness, LineJoin join = LineJoin_Miter, LineCap cap = LineCap_Butt)
+{
+    FlattenedPath *path = get_flattened_path(ui);
+    for (u32 subpath_index = 0; subpath_index < path->num_subpaths; ++subpath_index)
+    {
+        PathSubpath *subpath = path->subpaths + subpath_index;
+        if (subpath->num_points >= 2)
+        {
+            TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
+            add_polyline(ui, get_subpath_points(ui, path, subpath), subpath->num_points, color, thickness, subpath->closed, join, cap);
+            end_temp_memory(temp_memory);
+        }
+    }
+}
+
+// NOTE(dan): a sequence cut off by the end or with a byte that is not a continuation byte is invalid, only its first 
+//            byte is consumed so decoding picks up again right after it
+static u32 read_unicode(u8 **utf8_bytes_start, u8 *utf8_bytes_end, u32 invalid_unicode = UNICODE_REPLACEMENT_CHARACTER)
+{
+    // NOTE(dan): to get the unicode: extract x-es and glue them together
+    // 0x00000 - 0x00007F:  0xxx xxxx                                      // ascii
+    // 0x00080 - 0x0007FF:  110x xxxx  10xx xxxx                           // 1100 0000 == 0xC0
+    // 0x00800 - 0x07FFFF:  1110 xxxx  10xx xxxx  10xx xxxx                // 1110 0000 == 0xE0
+    // 0x10000 - 0x1FFFFF:  1111 0xxx  10xx xxxx  10xx xxxx  10xx xxxx     // 1111 0000 == 0xF0
+    u8 *c = *utf8_bytes_start;
+    u32 unicode = *c;
+    u32 num_bytes = 1;
+
+    if (*c >= 0x80)
+    {
+        if ((*c & 0xE0) == 0xC0) // NOTE(dan): 2 bytes
+        {
+            unicode = *c & 0x1F;
+            num_bytes = 2;
+        }
+        else if ((*c & 0xF0) == 0xE0) // NOTE(dan): 3 bytes
+        {
+            unicode = *c & 0x0F;
+            num_bytes = 3;
+        }
+        else if ((*c & 0xF8) == 0xF0) // NOTE(dan): 4 bytes
+        {
+            unicode = *c & 0x07;
+            num_bytes = 4;
+        }
+        else // NOTE(dan): a continuation byte or 0xF8 - 0xFF
+        {
+            num_bytes = 0;
+        }
+    }
+
+    b32 valid = (num_bytes && (usize)(utf8_bytes_end - c) >= num_bytes);
+    for (u32 byte_index = 1; valid && byte_index < num_bytes; ++byte_index)
+    {
+        valid = ((c[byte_index] & 0xC0) == 0x80);
+        unicode = (unicode << 6) | (c[byte_index] & 0x3F);
+    }
+
+    if (!valid)
+    {
+        unicode = invalid_unicode;
+        num_bytes = 1;
+    }
+
+    *utf8_bytes_start += num_bytes;
+    return unicode;
+}
+
+static void reset_glyph_atlas_band(GlyphAtlas *atlas, u32 band_index)
+{
+    GlyphAtlasBand *band = atlas->bands + band_index;
+    ++band->generation;
+    band->num_nodes = 1;
+    band->nodes[0].x = 0;
+    band->nodes[0].y = 0;
+    band->nodes[0].width = GLYPH_ATLAS_WIDTH;
+}
+
+// NOTE(dan): the lowest y a rect fits at with its left edge on the node, -1 when it does not fit
+static i32 fit_skyline(GlyphAtlasBand *band, u32 node_index, u32 width, u32 height)
+{
+    i32 result = -1;
+    if (band->nodes[node_index].x + width <= GLYPH_ATLAS_WIDTH)
+    {
+        u32 y = 0;
+        i32 width_left = (i32)width;
+        for (u32 test_node_index = node_index; width_left > 0; ++test_node_index)
+        {
+            SkylineNode *node = band->nodes + test_node_index;
+            y = (node->y > y) ? node->y : y;
+            width_left -= node->width;
+        }
+        result = (y + height <= GLYPH_ATLAS_BAND_HEIGHT) ? (i32)y : -1;
+    }
+    return result;
+}
+
+// NOTE(dan): bottom left skyline, the rect goes where its top is the lowest, ties go to the narrowest node
+static b32 pack_skyline(GlyphAtlasBand *band, u32 width, u32 height, u32 *x, u32 *y)
+{
+    u32 best_node_index = band->num_nodes;
+    u32 best_y = GLYPH_ATLAS_BAND_HEIGHT;
+    u32 best_width = GLYPH_ATLAS_WIDTH + 1;
+    for (u32 node_index = 0; node_index < band->num_nodes; ++node_index)
+    {
+        i32 fit_y = fit_skyline(band, node_index, width, height);
+        if (fit_y >= 0 && ((u32)fit_y < best_y || ((u32)fit_y == best_y && band->nodes[node_index].width < best_width)))
+        {
+            best_node_index = node_index;
+            best_y = (u32)fit_y;
+            best_width = band->nodes[node_index].width;
+        }
+    }
+
+    b32 packed = (best_node_index < band->num_nodes && band->num_nodes < MAX_NUM_SKYLINE_NODES);
+    if (packed)
+    {
+        *x = band->nodes[best_node_index].x;
+        *y = best_y;
+
+        for (u32 node_index = band->num_nodes; node_index > best_node_index; --node_index)
+        {
+            band->nodes[node_index] = band->nodes[node_index - 1];
+        }
+        ++band->num_nodes;
+
+        SkylineNode *new_node = band->nodes + best_node_index;
+        new_node->x = (u16)*x;
+        new_node->y = (u16)(best_y + height);
+        new_node->width = (u16)width;
+
+        // NOTE(dan): shrink or remove the nodes the new one covers
+        u32 node_index = best_node_index + 1;
+        b32 covered = true;
+        while (covered && node_index < band->num_nodes)
+        {
+            SkylineNode *node = band->nodes + node_index;
+            u32 covered_x = band->nodes[node_index - 1].x + band->nodes[node_index - 1].width;
+            covered = (node->x < covered_x);
+            if (covered)
+            {
+                u32 shrink = covered_x - node->x;
+                if (node->width <= shrink)
+                {
+                    for (u32 move_index = node_index; move_index + 1 < band->num_nodes; ++move_index)
+                    {
+                        band->nodes[move_index] = band->nodes[move_index + 1];
+                    }
+                    --band->num_nodes;
+                }
+                else
+                {
+                    node->x = (u16)(node->x + shrink);
+                    node->width = (u16)(node->width - shrink);
+                    covered = false;
+                }
+            }
+        }
+
+        for (node_index = 0; node_index + 1 < band->num_nodes;)
+        {
+            SkylineNode *node = band->nodes + node_index;
+            if (node->y == band->nodes[node_index + 1].y)
+            {
+                node->width = (u16)(node->width + band->nodes[node_index + 1].width);
+                for (u32 move_index = node_index + 1; move_index + 1 < band->num_nodes; ++move_index)
+                {
+                    band->nodes[move_index] = band->nodes[move_index + 1];
+                }
+                --band->num_nodes;
+            }
+            else
+            {
+                ++node_index;
+            }
+        }
+    }
+    return packed;
+}
+
+inline void mark_glyph_atlas_dirty(GlyphAtlas *atlas, u32 min_y, u32 max_y)
+{
+    atlas->dirty_min_y = (min_y < atlas->dirty_min_y) ? min_y : atlas->dirty_min_y;
+    atlas->dirty_max_y = (max_y > atlas->dirty_max_y) ? max_y : atlas->dirty_max_y;
+}
+
+// NOTE(dan): call with the atlas mutex held, a band is only evicted when no frame in flight can draw from it
+static b32 rasterize_atlas_glyph(UIState *ui, GlyphAtlas *atlas, Glyph *glyph)
+{
+    u32 glyph_width = (u32)(glyph->max_pos.x - glyph->min_pos.x);
+    u32 glyph_height = (u32)(glyph->max_pos.y - glyph->min_pos.y);
+    u32 width = glyph_width + 2 * GLYPH_ATLAS_PADDING;
+    u32 height = glyph_height + 2 * GLYPH_ATLAS_PADDING;
+
+    u32 x = 0;
+    u32 y = 0;
+    u32 band_index = 0;
+    b32 packed = false;
+    if (glyph_width && glyph_height)
+    {
+        while (!packed && band_index < NUM_GLYPH_ATLAS_BANDS)
+        {
+            packed = pack_skyline(atlas->bands + band_index, width, height, &x, &y);
+            if (!packed)
+            {
+                ++band_index;
+            }
+        }
+
+        if (!packed)
+        {
+            u32 lru_band_index = NUM_GLYPH_ATLAS_BANDS;
+            for (u32 test_band_index = 0; test_band_index < NUM_GLYPH_ATLAS_BANDS; ++test_band_index)
+            {
+                GlyphAtlasBand *band = atlas->bands + test_band_index;
+                if (band->last_used_frame + NUM_FRAME_PACKETS <= ui->frame_index &&
+                    (lru_band_index == NUM_GLYPH_ATLAS_BANDS || band->last_used_frame < atlas->bands[lru_band_index].last_used_frame))
+                {
+                    lru_band_index = test_band_index;
+                }
+            }
+
+            if (lru_band_index < NUM_GLYPH_ATLAS_BANDS)
+            {
+                band_index = lru_band_index;
+                reset_glyph_atlas_band(atlas, band_index);
+                ++atlas->num_evictions;
+
+                u32 band_min_y = band_index * GLYPH_ATLAS_BAND_HEIGHT;
+                u32 *pixels = atlas->pixels + band_min_y * GLYPH_ATLAS_WIDTH;
+                for (u32 pixel_index = 0; pixel_index < GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_BAND_HEIGHT; ++pixel_index)
+                {
+                    pixels[pixel_index] = 0xFFFFFF;
+                }
+                mark_glyph_atlas_dirty(atlas, band_min_y, band_min_y + GLYPH_ATLAS_BAND_HEIGHT);
+
+                packed = pack_skyline(atlas->bands + band_index, width, height, &x, &y);
+            }
+        }
+    }
+
+    if (packed)
+    {
+        u32 min_x = x + GLYPH_ATLAS_PADDING;
+        u32 min_y = band_index * GLYPH_ATLAS_BAND_HEIGHT + y + GLYPH_ATLAS_PADDING;
+
+        TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
+        u8 *coverage = push_array(&ui->memory, glyph_width * glyph_height, u8, no_clear());
+        stbtt_MakeGlyphBitmap(&atlas->font_info, coverage, glyph_width, glyph_height, glyph_width,
+                              atlas->font_scale, atlas->font_scale, glyph->font_glyph_index);
+
+        for (u32 row = 0; row < glyph_height; ++row)
+        {
+            u32 *dest_pixel = atlas->pixels + (min_y + row) * GLYPH_ATLAS_WIDTH + min_x;
+            u8 *src_pixel = coverage + row * glyph_width;
+            for (u32 column = 0; column < glyph_width; ++column)
+            {
+                dest_pixel[column] = 0xFFFFFF | (src_pixel[column] << 24);
+            }
+        }
+        end_temp_memory(temp_memory);
+
+        vec2 uv_scale = v2(1.0f / GLYPH_ATLAS_WIDTH, 1.0f / GLYPH_ATLAS_HEIGHT);
+        glyph->min_uv = vec2_hadamard(uv_scale, v2((f32)min_x, (f32)min_y));
+        glyph->max_uv = vec2_hadamard(uv_scale, v2((f32)(min_x + glyph_width), (f32)(min_y + glyph_height)));
+        glyph->atlas_band = band_index;
+        glyph->atlas_generation = atlas->bands[band_index].generation;
+
+        mark_glyph_atlas_dirty(atlas, min_y, min_y + glyph_height);
+        ++atlas->num_glyphs_rasterized;
+    }
+    return packed;
+}
+
+// NOTE(dan): rasterizes the glyph if its band was evicted and keeps the band for the frame, false when the glyph has 
+//            no pixels or there is no room for it
+static b32 use_atlas_glyph(UIState *ui, Glyph *glyph, vec2 *min_uv, vec2 *max_uv)
+{
+    GlyphAtlas *atlas = ui->glyph_atlas;
+    begin_mutex(&atlas->mutex);
+
+    b32 resident = (glyph->atlas_generation == atlas->bands[glyph->atlas_band].generation);
+    if (!resident)
+    {
+        resident = rasterize_atlas_glyph(ui, atlas, glyph);
+    }
+
+    if (resident)
+    {
+        atlas->bands[glyph->atlas_band].last_used_frame = ui->frame_index;
+        *min_uv = glyph->min_uv;
+        *max_uv = glyph->max_uv;
+
+        if (ui->current_panel)
+        {
+            ui->current_panel->glyph_atlas_bands |= (1 << glyph->atlas_band);
+        }
+    }
+
+    end_mutex(&atlas->mutex);
+    return resident;
+}
+
+// NOTE(dan): replayed geometry draws from the bands it was recorded with
+static void keep_glyph_atlas_bands(UIState *ui, u32 bands)
+{
+    GlyphAtlas *atlas = ui->glyph_atlas;
+    begin_mutex(&atlas->mutex);
+    for (u32 band_index = 0; band_index < NUM_GLYPH_ATLAS_BANDS; ++band_index)
+    {
+        if (bands & (1 << band_index))
+        {
+            atlas->bands[band_index].last_used_frame = ui->frame_index;
+        }
+    }
+    end_mutex(&atlas->mutex);
+}
+
+static TextRunChunk *push_text_run_chunk(UIState *ui, b32 cached)
+{
+    TextRunChunk *chunk = 0;
+    if (cached)
+    {
+        allocate_freelist(chunk, ui->first_free_text_run_chunk, push_struct(&ui->text_run_memory, TextRunChunk, no_clear()));
+        ui->num_text_run_bytes += sizeof(TextRunChunk);
+    }
+    else
+    {
+        chunk = push_struct(&ui->memory, TextRunChunk, no_clear());
+    }
+    chunk->next = 0;
+    return chunk;
+}
+
+inline u32 get_glyph_index(Font *font, unichar codepoint)
+{
+    u32 page_index = codepoint >> GLYPH_PAGE_SHIFT;
+    page_index = (page_index < NUM_GLYPH_PAGES) ? page_index : NUM_GLYPH_PAGES;
+
+    u32 result = font->glyph_pages[page_index]->glyph_indices[codepoint & (GLYPH_PAGE_SIZE - 1)];
+    return result;
+}
+
+inline f32 get_kern_advance(Font *font, u32 left_glyph_index, u32 right_glyph_index)
+{
+    f32 result = 0.0f;
+    u32 last_pair_index = font->kern_pair_offsets[left_glyph_index + 1];
+    for (u32 pair_index = font->kern_pair_offsets[left_glyph_index];
+         (pair_index < last_pair_index) && (font->kern_pair_glyphs[pair_index] <= right_glyph_index);
+         ++pair_index)
+    {
+        if (font->kern_pair_glyphs[pair_index] == right_glyph_index)
+        {
+            result = font->kern_pair_advances[pair_index];
+        }
+    }
+    return result;
+}
+
+// NOTE(dan): only text draws from the sdf font, shapes keep using the white pixel of the current font
+inline Font *get_text_font(UIState *ui)
+{
+    Font *font = ui->sdf_text ? ui->sdf_font : ui->current_font;
+    return font;
+}
+
+// NOTE(dan): decodes the text and looks its glyphs up once, kerning goes into the pen positions
+static void shape_text_run(UIState *ui, TextRun *run, char *text, f32 size, b32 cached)
+{
+    Font *font = get_text_font(ui);
+    char *at = text;
+    char *end = text + string_length(text);
+    f32 scale = size / font->size;
+    f32 pen_x = 0.0f;
+
+    run->num_glyphs = 0;
+    run->first_chunk = 0;
+    TextRunChunk *last_chunk = 0;
+
+    b32 has_prev_glyph = false;
+    u32 prev_glyph_index = 0;
+    while (at < end)
+    {
+        // NOTE(dan): the printable ascii at the start of the block has a glyph for every byte, the pen positions are a 
+        //            prefix sum of the advances, bytes below 0x20 compare less as signed and so do the ones with the high 
+        //            bit set, the tail is copied into zeros which are not printable so it ends the block too
+        u32 num_block_glyphs = 0;
+        u16 block_glyph_indices[TEXT_SIMD_BLOCK_SIZE];
+        f32 block_offsets_x[TEXT_SIMD_BLOCK_SIZE];
+        u8 tail[TEXT_SIMD_BLOCK_SIZE] = {};
+        u8 *block = (u8 *)at;
+        if (font->has_printable_ascii)
+        {
+            if (end - at < TEXT_SIMD_BLOCK_SIZE)
+            {
+                copy_memory(tail, at, end - at);
+                block = tail;
+            }
+
+            __m128i bytes = _mm_loadu_si128((__m128i *)block);
+            __m128i not_printable = _mm_or_si128(_mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20)), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7F)));
+            u32 not_printable_mask = _mm_movemask_epi8(not_printable);
+            num_block_glyphs = not_printable_mask ? find_least_significant_set_bit(not_printable_mask) : TEXT_SIMD_BLOCK_SIZE;
+        }
+
+        if (num_block_glyphs)
+        {
+            // NOTE(dan): sse2 has no gather, the advances are loaded 4 at a time into a vector and scaled together, 
+            //            they are shifted by one so the step to a glyph is the advance of the one before it, lanes past 
+            //            the printable bytes are masked into the table and never read back
+            f32 advances_x[TEXT_SIMD_BLOCK_SIZE + 4];
+            f32 kerning_x[TEXT_SIMD_BLOCK_SIZE];
+            __m128 advance_scale = _mm_set1_ps(scale);
+            _mm_storeu_ps(advances_x, _mm_setzero_ps());
+            for (u32 block_index = 0; block_index < TEXT_SIMD_BLOCK_SIZE; block_index += 4)
+            {
+                u8 *bytes = block + block_index;
+                __m128 advances = _mm_setr_ps(font->ascii_advances_x[bytes[0] & 0x7F], font->ascii_advances_x[bytes[1] & 0x7F], 
+                                              font->ascii_advances_x[bytes[2] & 0x7F], font->ascii_advances_x[bytes[3] & 0x7F]);
+                _mm_storeu_ps(advances_x + block_index + 1, _mm_mul_ps(advances, advance_scale));
+                _mm_storeu_ps(kerning_x + block_index, _mm_setzero_ps());
+            }
+
+            // NOTE(dan): the first glyph can follow any glyph, the others follow ascii and only kerned pairs are searched
+            for (u32 block_index = 0; block_index < num_block_glyphs; ++block_index)
+            {
+                u8 byte = block[block_index];
+                u32 glyph_index = font->ascii_glyph_indices[byte];
+                if (block_index == 0 && has_prev_glyph && font->num_kern_pairs)
+                {
+                    kerning_x[0] = scale * get_kern_advance(font, prev_glyph_index, glyph_index);
+                }
+                else if (block_index && (font->ascii_kern_bits[block[block_index - 1]][byte / 32] & (1 << (byte % 32))))
+                {
+                    kerning_x[block_index] = scale * get_kern_advance(font, prev_glyph_index, glyph_index);
+                }
+                prev_glyph_index = glyph_index;
+                block_glyph_indices[block_index] = (u16)glyph_index;
+            }
+            has_prev_glyph = true;
 
-    Vertex *vertices = ui->vertices + ui->num_vertices;
-    GLuint *elements = ui->elements + ui->num_elements;
+            __m128 carry = _mm_set1_ps(pen_x);
+            for (u32 block_index = 0; block_index < num_block_glyphs; block_index += 4)
+            {
+                __m128 offsets_x = _mm_add_ps(_mm_loadu_ps(advances_x + block_index), _mm_loadu_ps(kerning_x + block_index));
+                offsets_x = _mm_add_ps(offsets_x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(offsets_x), 4)));
+                offsets_x = _mm_add_ps(offsets_x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(offsets_x), 8)));
+                offsets_x = _mm_add_ps(offsets_x, carry);
+                _mm_storeu_ps(block_offsets_x + block_index, offsets_x);
+                carry = _mm_shuffle_ps(offsets_x, offsets_x, _MM_SHUFFLE(3, 3, 3, 3));
+            }
+            pen_x = block_offsets_x[num_block_glyphs - 1] + advances_x[num_block_glyphs];
+            at += num_block_glyphs;
+        }
 
-    vertices[0].pos = v2(top_left_corner.x, top_left_corner.y);
-    vertices[0].uv = uv;
-    vertices[0].color = top_left_color;
+        if (!num_block_glyphs)
+        {
+            unichar c = (unichar)read_unicode((u8 **)&at, (u8 *)end);
+            u32 glyph_index = (c < NUM_ASCII_CODEPOINTS) ? font->ascii_glyph_indices[c] : get_glyph_index(font, c);
+            if (glyph_index != MISSING_GLYPH)
+            {
+                if (has_prev_glyph)
+                {
+                    pen_x += scale * get_kern_advance(font, prev_glyph_index, glyph_index);
+                }
+                has_prev_glyph = true;
+                prev_glyph_index = glyph_index;
 
-    vertices[1].pos = v2(top_left_corner.x, bottom_right_corner.y);
-    vertices[1].uv = uv;
-    vertices[1].color = bottom_left_color;
+                block_glyph_indices[0] = (u16)glyph_index;
+                block_offsets_x[0] = pen_x;
+                num_block_glyphs = 1;
 
-    vertices[2].pos = v2(bottom_right_corner.x, bottom_right_corner.y);
-    vertices[2].uv = uv;
-    vertices[2].color = bottom_right_color;
+                // TODO(dan): wordwrap, clip
+                pen_x += scale * font->glyphs[glyph_index].advance_x;
+            }
+        }
 
-    vertices[3].pos = v2(bottom_right_corner.x, top_left_corner.y);
-    vertices[3].uv = uv;
-    vertices[3].color = top_right_color;
+        for (u32 block_index = 0; block_index < num_block_glyphs; ++block_index)
+        {
+            u32 chunk_glyph_index = run->num_glyphs % TEXT_RUN_CHUNK_SIZE;
+            if (!chunk_glyph_index)
+            {
+                TextRunChunk *chunk = push_text_run_chunk(ui, cached);
+                if (last_chunk)
+                {
+                    last_chunk->next = chunk;
+                }
+                else
+                {
+                    run->first_chunk = chunk;
+                }
+                last_chunk = chunk;
+            }
 
-    elements[0] = vertice_index + 0;
-    elements[1] = vertice_index + 1;
-    elements[2] = vertice_index + 2;
-    elements[3] = vertice_index + 0;
-    elements[4] = vertice_index + 2;
-    elements[5] = vertice_index + 3;
+            last_chunk->glyph_indices[chunk_glyph_index] = block_glyph_indices[block_index];
+            last_chunk->offsets_x[chunk_glyph_index] = block_offsets_x[block_index];
+            ++run->num_glyphs;
+        }
+    }
 
-    ui->num_vertices += 4;
-    ui->num_elements += 6;
+    // TODO(dan): calc when we have wordwrap
+    run->size = v2(pen_x, size);
 }
 
-static void add_poly_filled(UIState *ui, vec2 *vertices, u32 num_vertices, u32 color)
+inline void free_text_run_chunks(UIState *ui, TextRunChunk *chunk)
 {
-    u32 start_vertice_index = ui->num_vertices;
-    u32 num_elements = (num_vertices - 2) * 3;
-
-    assert(ui->num_vertices + num_vertices < MAX_NUM_VERTICES);
-    assert(ui->num_elements + num_elements < MAX_NUM_ELEMENTS);
-
-    for (u32 vertex_index = 0; vertex_index < num_vertices; ++vertex_index)
-    {
-        Vertex *vertex = ui->vertices + ui->num_vertices++;
-        vertex->pos.x = vertices[vertex_index].x;
-        vertex->pos.y = vertices[vertex_index].y;
-        vertex->uv = ui->current_font.white_pixel_uv;
-        vertex->color = color;
-    }
-
-    for (u32 element_index = 2; element_index < num_vertices; ++element_index)
+    while (chunk)
     {
-        GLuint *element = ui->elements + ui->num_elements;
-        element[0] = start_vertice_index;
-        element[1] = start_vertice_index + element_index - 1;
-        element[2] = start_vertice_index + element_index;
-
-        ui->num_elements += 3;
+        TextRunChunk *next_chunk = chunk->next;
+        deallocate_freelist(chunk, ui->first_free_text_run_chunk);
+        ui->num_text_run_bytes -= sizeof(TextRunChunk);
+        chunk = next_chunk;
     }
 }
 
-static void add_rect_outline(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, u32 color)
+static void evict_text_run(UIState *ui, TextRun *run)
 {
-    top_left_corner = vec2_add(top_left_corner, v2(0.5f, 0.5f));
-    bottom_right_corner = vec2_sub(bottom_right_corner, v2(0.5f, 0.5f));
-    vec2 vertices[] =
+    TextRun **link = ui->text_run_hash + (run->key & (TEXT_RUN_HASH_SIZE - 1));
+    while (*link != run)
     {
-        v2(top_left_corner.x, top_left_corner.y),
-        v2(top_left_corner.x, bottom_right_corner.y),
-        v2(bottom_right_corner.x, bottom_right_corner.y),
-        v2(bottom_right_corner.x, top_left_corner.y),
-    };
-    add_poly_outline(ui, vertices, array_count(vertices), color, 1.0f, true);
-}
+        link = &(*link)->next_in_hash;
+    }
+    *link = run->next_in_hash;
 
-static void add_rect_filled(UIState *ui, vec2 top_left_corner, vec2 bottom_right_corner, u32 color)
-{
-    vec2 vertices[] =
-    {
-        v2(top_left_corner.x,     top_left_corner.y),
-        v2(top_left_corner.x,     bottom_right_corner.y),
-        v2(bottom_right_corner.x, bottom_right_corner.y),
-        v2(bottom_right_corner.x, top_left_corner.y),
-    };
-    add_poly_filled(ui, vertices, array_count(vertices), color);
+    run->prev->next = run->next;
+    run->next->prev = run->prev;
+
+    free_text_run_chunks(ui, run->first_chunk);
+    free_text_run_chunks(ui, run->first_text_chunk);
+
+    deallocate_freelist(run, ui->first_free_text_run);
+    ui->num_text_run_bytes -= sizeof(TextRun);
+    --ui->num_text_runs;
 }
 
-static void add_arc_filled(UIState *ui, vec2 center, f32 radius, u32 color, f32 start_angle, f32 end_angle, u32 num_segments)
+static void store_text_run_text(UIState *ui, TextRun *run, char *text, u32 text_length)
 {
-    TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
-    {
-        vec2 *vertices = push_array(&ui->memory, num_segments + 1, vec2);
+    run->text_length = text_length;
+    run->first_text_chunk = 0;
 
-        f32 angle_step = (end_angle - start_angle) / num_segments;
-        for (u32 vertex_index = 0; vertex_index <= num_segments; ++vertex_index)
+    TextRunChunk *last_chunk = 0;
+    for (u32 offset = 0; offset < text_length; offset += sizeof(last_chunk->text))
+    {
+        TextRunChunk *chunk = push_text_run_chunk(ui, true);
+        if (last_chunk)
         {
-            f32 angle = start_angle + (f32)vertex_index * angle_step;
-
-            vertices[vertex_index].x = center.x + cos32(angle) * radius;
-            vertices[vertex_index].y = center.y - sin32(angle) * radius;
+            last_chunk->next = chunk;
+        }
+        else
+        {
+            run->first_text_chunk = chunk;
         }
+        last_chunk = chunk;
 
-        add_poly_filled(ui, vertices, num_segments + 1, color);
+        u32 num_bytes = text_length - offset;
+        num_bytes = (num_bytes < sizeof(chunk->text)) ? num_bytes : sizeof(chunk->text);
+        copy_memory(chunk->text, text + offset, num_bytes);
     }
-    end_temp_memory(temp_memory);
-}
-
-inline void add_circle_filled(UIState *ui, vec2 center, f32 radius, u32 color)
-{
-    add_arc_filled(ui, center, radius, color, 0.0f, TAU32, 24);
 }
 
-static u32 read_unicode(u8 **utf8_bytes_start, u8 *utf8_bytes_end, u32 default_unicode = 0)
+inline b32 text_run_matches(TextRun *run, u64 key, Font *font, f32 size, char *text, u32 text_length)
 {
-    // NOTE(dan): to get the unicode: extract x-es and glue them together
-    // 0x00000 - 0x00007F:  0xxx xxxx                                      // ascii
-    // 0x00080 - 0x0007FF:  110x xxxx  10xx xxxx                           // 1100 0000 == 0xC0
-    // 0x00800 - 0x07FFFF:  1110 xxxx  10xx xxxx  10xx xxxx                // 1110 0000 == 0xE0
-    // 0x10000 - 0x1FFFFF:  1111 0xxx  10xx xxxx  10xx xxxx  10xx xxxx     // 1111 0000 == 0xF0
-    u32 unicode = default_unicode;
-    u32 num_bytes_read = 0;
+    b32 matches = (run->key == key && run->font == font && run->font_size == font->size && 
+                   run->text_size == size && run->text_length == text_length);
 
-    u8 *c = *utf8_bytes_start;
-    if (*c < 0x80) // NOTE(dan): 1 byte - ascii
+    u32 offset = 0;
+    for (TextRunChunk *chunk = run->first_text_chunk; matches && chunk; chunk = chunk->next)
     {
-        unicode = *c;
-        num_bytes_read = 1;
-    }
-    else if ((*c & 0xE0) == 0xC0) // NOTE(dan): 2 bytes
-    {
-        if (c + 1 < utf8_bytes_end)
+        u32 num_bytes = text_length - offset;
+        num_bytes = (num_bytes < sizeof(chunk->text)) ? num_bytes : sizeof(chunk->text);
+        for (u32 byte_index = 0; matches && byte_index < num_bytes; ++byte_index)
         {
-            u8 byte_0_bits = c[0] & 0x1F;
-            u8 byte_1_bits = c[1] & 0x3F;
-
-            unicode = (byte_0_bits << 6) | byte_1_bits;
+            matches = (chunk->text[byte_index] == text[offset + byte_index]);
         }
-        num_bytes_read = 2;
+        offset += num_bytes;
     }
-    else if ((*c & 0xF0) == 0xE0) // NOTE(dan): 3 bytes
+    return matches;
+}
+
+// NOTE(dan): runs are looked up by the hash of the text, the font and the size, the least recently used ones are 
+//            evicted while the cache is over its budget, without the cache the text is shaped into scratch_run with 
+//            chunks in temp memory the caller owns
+static TextRun *get_text_run(UIState *ui, char *text, f32 size, TextRun *scratch_run)
+{
+    TextRun *run = 0;
+    if (ui->cache_text_runs)
     {
-        if (c + 2 < utf8_bytes_end)
+        Font *font = get_text_font(ui);
+        u32 text_length = string_length(text);
+        u64 key = hash_string(FNV_HASH_SEED, text);
+        key = hash_words(key, &size, sizeof(size));
+        key = hash_words(key, &font->size, sizeof(font->size));
+        key = hash_words(key, &font->texture_slot, sizeof(font->texture_slot));
+
+        TextRun **bucket = ui->text_run_hash + (key & (TEXT_RUN_HASH_SIZE - 1));
+        for (TextRun *test_run = *bucket; !run && test_run; test_run = test_run->next_in_hash)
         {
-            u8 byte_0_bits = c[0] & 0x0F;
-            u8 byte_1_bits = c[1] & 0x3F;
-            u8 byte_2_bits = c[2] & 0x3F;
+            if (text_run_matches(test_run, key, font, size, text, text_length))
+            {
+                run = test_run;
+            }
+        }
 
-            unicode = (byte_0_bits << 12) | (byte_1_bits << 6) | byte_2_bits;
+        if (run)
+        {
+            run->prev->next = run->next;
+            run->next->prev = run->prev;
         }
-        num_bytes_read = 3;
-    }
-    else // NOTE(dan): 4 bytes
-    {
-        assert((*c & 0xF8) == 0xF0);
-        if (c + 3 < utf8_bytes_end)
+        else
         {
-            u8 byte_0_bits = c[0] & 0x07;
-            u8 byte_1_bits = c[1] & 0x3F;
-            u8 byte_2_bits = c[2] & 0x3F;
-            u8 byte_3_bits = c[3] & 0x3F;
+            allocate_freelist(run, ui->first_free_text_run, push_struct(&ui->text_run_memory, TextRun, no_clear()));
+            ui->num_text_run_bytes += sizeof(TextRun);
+            ++ui->num_text_runs;
+
+            run->key = key;
+            run->font = font;
+            run->font_size = font->size;
+            run->text_size = size;
+            store_text_run_text(ui, run, text, text_length);
+            shape_text_run(ui, run, text, size, true);
+            run->next_in_hash = *bucket;
+            *bucket = run;
+        }
+        dllist_insert_last(&ui->text_run_sentinel, run);
 
-            unicode = (byte_0_bits << 18) | (byte_1_bits << 12) | (byte_2_bits << 6) | byte_3_bits;
+        while (ui->num_text_run_bytes > ui->text_run_budget && ui->text_run_sentinel.next != run)
+        {
+            evict_text_run(ui, ui->text_run_sentinel.next);
         }
-        num_bytes_read = 4;
     }
-
-    *utf8_bytes_start += num_bytes_read;
-    return unicode;
+    else
+    {
+        run = scratch_run;
+        shape_text_run(ui, run, text, size, false);
+    }
+    return run;
 }
 
 static vec2 calc_text_size(UIState *ui, char *text, f32 size)
 {
-    Font *font = &ui->current_font;
-    char *at = text;
-    char *end = text + string_length(text);
-    vec2 at_pos = v2(0, 0);
-    f32 scale = size / font->size;
-
-    while (at < end)
-    {
-        u32 unicode = read_unicode((u8 **)&at, (u8 *)end);
-        if (!unicode)
-        {
-            break;
-        }
-
-        // TODO(dan): 0xFF -> max unicode codepoint
-        unichar c = (unichar)unicode;
-        if (c < 0xFF)
-        {
-            u16 glyph_index = font->glyph_index_lut[c];
-            Glyph *glyph = font->glyphs + glyph_index;
-
-            // TODO(dan): wordwrap, clip
-            at_pos.x += scale * glyph->advance_x;
-        }
-    }
+    TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
 
-    // TODO(dan): calc when we have wordwrap
-    at_pos.y = size;
+    TextRun scratch_run;
+    TextRun *run = get_text_run(ui, text, size, &scratch_run);
+    vec2 text_size = run->size;
 
-    return at_pos;
+    end_temp_memory(temp_memory);
+    return text_size;
 }
 
 static vec2 add_text(UIState *ui, char *text, vec2 pos, f32 size, u32 color)
 {
-    Font *font = &ui->current_font;
-    char *at = text;
-    char *end = text + string_length(text);
-    vec2 at_pos = pos;
+    Font *font = get_text_font(ui);
     f32 scale = size / font->size;
 
-    u32 prev_unicode = 0;
-    while (at < end)
-    {
-        u32 unicode = read_unicode((u8 **)&at, (u8 *)end);
-        if (!unicode)
-        {
-            break;
-        }
+    TempMemoryStack temp_memory = begin_temp_memory(&ui->memory);
 
-        if (prev_unicode)
-        {
-            // TODO(dan): the default font does not have a kern table!
-            at_pos.x += stbtt_GetCodepointKernAdvance(&font->font_info, prev_unicode, unicode);
-        }
-        prev_unicode = unicode;
+    TextRun scratch_run;
+    TextRun *run = get_text_run(ui, text, size, &scratch_run);
 
-        // TODO(dan): 0xFF -> max unicode codepoint
-        unichar c = (unichar)unicode;
-        if (c < 0xFF)
+    u32 num_glyphs_left = run->num_glyphs;
+    for (TextRunChunk *chunk = run->first_chunk; chunk; chunk = chunk->next)
+    {
+        u32 num_chunk_glyphs = (num_glyphs_left < TEXT_RUN_CHUNK_SIZE) ? num_glyphs_left : TEXT_RUN_CHUNK_SIZE;
+        for (u32 chunk_glyph_index = 0; chunk_glyph_index < num_chunk_glyphs; ++chunk_glyph_index)
         {
-            u16 glyph_index = font->glyph_index_lut[c];
-            Glyph *glyph = font->glyphs + glyph_index;
-
-            vec2 top_left_corner     = vec2_add(at_pos, vec2_mul(scale, glyph->min_pos));
-            vec2 bottom_right_corner = vec2_add(at_pos, vec2_mul(scale, glyph->max_pos));
+            Glyph *glyph = font->glyphs + chunk->glyph_indices[chunk_glyph_index];
+            vec2 pen_pos = v2(pos.x + chunk->offsets_x[chunk_glyph_index], pos.y);
 
-            add_textured_quad(ui, top_left_corner, bottom_right_corner, glyph->min_uv, glyph->max_uv, color);
+            vec2 top_left_corner     = vec2_add(pen_pos, vec2_mul(scale, glyph->min_pos));
+            vec2 bottom_right_corner = vec2_add(pen_pos, vec2_mul(scale, glyph->max_pos));
 
-            // TODO(dan): wordwrap, clip
-            at_pos.x += scale * glyph->advance_x;
+            if (glyph->font_glyph_index)
+            {
+                vec2 min_uv;
+                vec2 max_uv;
+                if (use_atlas_glyph(ui, glyph, &min_uv, &max_uv))
+                {
+                    add_textured_quad(ui, top_left_corner, bottom_right_corner, min_uv, max_uv, color, ui->glyph_atlas->texture_slot);
+                }
+            }
+            else
+            {
+                add_textured_quad(ui, top_left_corner, bottom_right_corner, glyph->min_uv, glyph->max_uv, color, font->texture_slot);
+            }
         }
+        num_glyphs_left -= num_chunk_glyphs;
     }
+    vec2 text_size = run->size;
 
-    // TODO(dan): calc when we have wordwrap
-    at_pos.y += size;
-
-    vec2 text_size = vec2_sub(at_pos, pos);
+    end_temp_memory(temp_memory);
     return text_size;
 }
 
@@ -398,18 +2140,262 @@ inline u32 upper_pow2(u32 value)
     return value; 
 }
 
+static void init_glyph_pages(MemoryStack *memory, Font *font)
+{
+    GlyphPage *missing_glyph_page = push_struct(memory, GlyphPage, no_clear());
+    for (u32 page_glyph_index = 0; page_glyph_index < GLYPH_PAGE_SIZE; ++page_glyph_index)
+    {
+        missing_glyph_page->glyph_indices[page_glyph_index] = MISSING_GLYPH;
+    }
+
+    font->glyph_pages = push_array(memory, NUM_GLYPH_PAGES + 1, GlyphPage *, no_clear());
+    for (u32 page_index = 0; page_index < NUM_GLYPH_PAGES + 1; ++page_index)
+    {
+        font->glyph_pages[page_index] = missing_glyph_page;
+    }
+
+    for (u32 glyph_index = 0; glyph_index < font->num_glyphs; ++glyph_index)
+    {
+        unichar codepoint = font->glyphs[glyph_index].codepoint;
+        GlyphPage **glyph_page = font->glyph_pages + (codepoint >> GLYPH_PAGE_SHIFT);
+
+        if (*glyph_page == missing_glyph_page)
+        {
+            *glyph_page = push_struct(memory, GlyphPage, no_clear());
+            copy_memory(*glyph_page, missing_glyph_page, sizeof(GlyphPage));
+        }
+        (*glyph_page)->glyph_indices[codepoint & (GLYPH_PAGE_SIZE - 1)] = (u16)glyph_index;
+    }
+
+    font->has_printable_ascii = true;
+    for (unichar codepoint = 0; codepoint < NUM_ASCII_CODEPOINTS; ++codepoint)
+    {
+        u32 glyph_index = get_glyph_index(font, codepoint);
+        font->ascii_glyph_indices[codepoint] = (u16)glyph_index;
+        font->ascii_advances_x[codepoint] = (glyph_index != MISSING_GLYPH) ? font->glyphs[glyph_index].advance_x : 0.0f;
+
+        if (codepoint >= 0x20 && codepoint < 0x7F && glyph_index == MISSING_GLYPH)
+        {
+            font->has_printable_ascii = false;
+        }
+    }
+}
+
+// NOTE(dan): only the first num_kerned_glyphs are kerned, atlas glyphs are not, a table for all of cjk would be 
+//            quadratic in its size
+static void init_kern_pairs(MemoryStack *memory, Font *font, stbtt_fontinfo *font_info, f32 font_scale, u32 num_kerned_glyphs)
+{
+    // NOTE(dan): the kern table is only read here, a pass to count the pairs and a pass to fill them in
+    font->num_kern_pairs = 0;
+    font->kern_pair_offsets = push_array(memory, font->num_glyphs + 1, u32);
+
+    i32 *font_glyph_indices = push_array(memory, num_kerned_glyphs, i32, no_clear());
+    for (u32 glyph_index = 0; glyph_index < num_kerned_glyphs; ++glyph_index)
+    {
+        font_glyph_indices[glyph_index] = font_info->kern ? stbtt_FindGlyphIndex(font_info, font->glyphs[glyph_index].codepoint) : 0;
+    }
+
+    if (font_info->kern)
+    {
+        for (u32 left_glyph_index = 0; left_glyph_index < num_kerned_glyphs; ++left_glyph_index)
+        {
+            for (u32 right_glyph_index = 0; right_glyph_index < num_kerned_glyphs; ++right_glyph_index)
+            {
+                if (stbtt_GetGlyphKernAdvance(font_info, font_glyph_indices[left_glyph_index], font_glyph_indices[right_glyph_index]))
+                {
+                    ++font->num_kern_pairs;
+                }
+            }
+        }
+    }
+
+    font->kern_pair_glyphs = push_array(memory, font->num_kern_pairs, u16, no_clear());
+    font->kern_pair_advances = push_array(memory, font->num_kern_pairs, f32, no_clear());
+
+    u32 num_kern_pairs = 0;
+    for (u32 left_glyph_index = 0; left_glyph_index < font->num_glyphs; ++left_glyph_index)
+    {
+        font->kern_pair_offsets[left_glyph_index] = num_kern_pairs;
+        for (u32 right_glyph_index = 0;
+             (left_glyph_index < num_kerned_glyphs) && (right_glyph_index < num_kerned_glyphs) && (num_kern_pairs < font->num_kern_pairs);
+             ++right_glyph_index)
+        {
+            i32 unscaled_advance = stbtt_GetGlyphKernAdvance(font_info, font_glyph_indices[left_glyph_index], font_glyph_indices[right_glyph_index]);
+            if (unscaled_advance)
+            {
+                font->kern_pair_glyphs[num_kern_pairs] = (u16)right_glyph_index;
+                font->kern_pair_advances[num_kern_pairs] = font_scale * unscaled_advance;
+                ++num_kern_pairs;
+            }
+        }
+    }
+    font->kern_pair_offsets[font->num_glyphs] = num_kern_pairs;
+
+    zero_struct(font->ascii_kern_bits);
+    for (u32 left = 0; left < NUM_ASCII_CODEPOINTS; ++left)
+    {
+        u32 left_glyph_index = font->ascii_glyph_indices[left];
+        for (u32 right = 0; (left_glyph_index != MISSING_GLYPH) && (right < NUM_ASCII_CODEPOINTS); ++right)
+        {
+            u32 right_glyph_index = font->ascii_glyph_indices[right];
+            if (right_glyph_index != MISSING_GLYPH && get_kern_advance(font, left_glyph_index, right_glyph_index) != 0.0f)
+            {
+                font->ascii_kern_bits[left][right / 32] |= (1 << (right % 32));
+            }
+        }
+    }
+}
+
+// NOTE(dan): the glyphs are the codepoints baked into the default texture, atlas glyphs have no sdf
+static void init_sdf_font(MemoryStack *memory, Font *font, stbtt_fontinfo *font_info, i32 *codepoints, u32 num_codepoints)
+{
+    font->size = SDF_FONT_SIZE;
+    font->texture_width = SDF_TEXTURE_WIDTH;
+    font->white_pixel_uv = v2(0, 0);
+    f32 font_scale = stbtt_ScaleForPixelHeight(font_info, font->size);
+
+    i32 unscaled_ascent;
+    i32 unscaled_descent;
+    i32 unscaled_line_gap;
+    stbtt_GetFontVMetrics(font_info, &unscaled_ascent, &unscaled_descent, &unscaled_line_gap);
+
+    font->ascent = font_scale * unscaled_ascent;
+    font->descent = font_scale * unscaled_descent;
+
+    font->num_glyphs = num_codepoints;
+    font->glyphs = push_array(memory, num_codepoints, Glyph);
+    i32 *font_glyph_indices = push_array(memory, num_codepoints, i32, no_clear());
+    stbrp_rect *packed_rects = push_array(memory, num_codepoints, stbrp_rect);
+
+    // NOTE(dan): the boxes are known before anything is rasterized, the same ones stbtt_GetGlyphSDF pads
+
+    for (u32 glyph_index = 0; glyph_index < num_codepoints; ++glyph_index)
+    {
+        Glyph *glyph = font->glyphs + glyph_index;
+        i32 font_glyph_index = stbtt_FindGlyphIndex(font_info, codepoints[glyph_index]);
+        font_glyph_indices[glyph_index] = font_glyph_index;
+
+        i32 unscaled_advance_x;
+        i32 unscaled_left_side_bearing;
+        stbtt_GetGlyphHMetrics(font_info, font_glyph_index, &unscaled_advance_x, &unscaled_left_side_bearing);
+
+        i32 x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox(font_info, font_glyph_index, font_scale, font_scale, &x0, &y0, &x1, &y1);
+
+        b32 empty = (x0 == x1 || y0 == y1);
+        i32 width = empty ? 0 : x1 - x0 + 2 * SDF_PADDING;
+        i32 height = empty ? 0 : y1 - y0 + 2 * SDF_PADDING;
+        i32 x_offset = x0 - SDF_PADDING;
+        i32 y_offset = y0 - SDF_PADDING;
+
+        glyph->codepoint = (unichar)codepoints[glyph_index];
+        glyph->advance_x = font_scale * unscaled_advance_x;
+        glyph->min_pos = v2((f32)x_offset, (f32)y_offset + font->ascent);
+        glyph->max_pos = v2((f32)(x_offset + width), (f32)(y_offset + height) + font->ascent);
+
+        // NOTE(dan): a texel between the glyphs so filtering does not pick up the neighbours
+        packed_rects[glyph_index].w = empty ? 0 : width + 1;
+        packed_rects[glyph_index].h = empty ? 0 : height + 1;
+    }
+
+    stbrp_context pack_context;
+    stbrp_init_target(&pack_context, font->texture_width, 1024 * 32, 0, 0);
+    stbrp_pack_rects(&pack_context, packed_rects, num_codepoints);
+
+    font->texture_height = 1;
+    for (u32 glyph_index = 0; glyph_index < num_codepoints; ++glyph_index)
+    {
+        stbrp_rect *packed_rect = packed_rects + glyph_index;
+        if (packed_rect->was_packed)
+        {
+            font->texture_height = max(font->texture_height, (u32)(packed_rect->y + packed_rect->h));
+        }
+    }
+    font->texture_height = upper_pow2(font->texture_height);
+
+    u32 *pixels = push_array(memory, font->texture_width * font->texture_height, u32, no_clear());
+    for (u32 pixel_index = 0; pixel_index < font->texture_width * font->texture_height; ++pixel_index)
+    {
+        pixels[pixel_index] = 0xFFFFFF;
+    }
+    font->texture_pixels = (u8 *)pixels;
+
+    // NOTE(dan): each glyph is rasterized into the top of the stack and copied into the texture right away, 
+    //            stb_truetype allocates from the stack while the font has it as user data
+    void *font_userdata = font_info->userdata;
+    font_info->userdata = memory;
+
+    vec2 uv_scale = v2(1.0f / font->texture_width, 1.0f / font->texture_height);
+    for (u32 glyph_index = 0; glyph_index < num_codepoints; ++glyph_index)
+    {
+        Glyph *glyph = font->glyphs + glyph_index;
+        stbrp_rect *packed_rect = packed_rects + glyph_index;
+
+        TempMemoryStack glyph_memory = begin_temp_memory(memory);
+        u8 *bitmap = 0;
+        if (packed_rect->w && packed_rect->was_packed)
+        {
+            i32 x_offset, y_offset, bitmap_width, bitmap_height;
+            bitmap = stbtt_GetGlyphSDF(font_info, font_scale, font_glyph_indices[glyph_index], SDF_PADDING, SDF_ON_EDGE_VALUE, 
+                                       SDF_PIXEL_DIST_SCALE, &bitmap_width, &bitmap_height, &x_offset, &y_offset);
+            assert(!bitmap || (bitmap_width + 1 == packed_rect->w && bitmap_height + 1 == packed_rect->h));
+        }
+
+        if (bitmap)
+        {
+            u32 width = (u32)packed_rect->w - 1;
+            u32 height = (u32)packed_rect->h - 1;
+            for (u32 row = 0; row < height; ++row)
+            {
+                u32 *dest_pixel = pixels + (packed_rect->y + row) * font->texture_width + packed_rect->x;
+                u8 *src_pixel = bitmap + row * width;
+                for (u32 column = 0; column < width; ++column)
+                {
+                    dest_pixel[column] = 0xFFFFFF | (src_pixel[column] << 24);
+                }
+            }
+
+            glyph->min_uv = vec2_hadamard(uv_scale, v2((f32)packed_rect->x, (f32)packed_rect->y));
+            glyph->max_uv = vec2_hadamard(uv_scale, v2((f32)(packed_rect->x + width), (f32)(packed_rect->y + height)));
+        }
+        else
+        {
+            glyph->max_pos = glyph->min_pos;
+        }
+        end_temp_memory(glyph_memory);
+    }
+    font_info->userdata = font_userdata;
+
+    init_glyph_pages(memory, font);
+    init_kern_pairs(memory, font, font_info, font_scale, font->num_glyphs);
+}
+
 static void init_default_ui_texture(UIState *ui)
 {
     // TODO(dan): replace this font, it does not have extended latin chars
     unichar glyph_ranges[] =
     {
-        0x0020, 0x00FF,
+        0x0020, 0x00FF, // NOTE(dan): basic latin, latin-1 supplement
+        0x0100, 0x017F, // NOTE(dan): latin extended-a
+        0x0370, 0x03FF, // NOTE(dan): greek
+        0x0400, 0x04FF, // NOTE(dan): cyrillic
+        0
+    };
+
+    // NOTE(dan): too many glyphs to bake, rasterized into the glyph atlas when they are first drawn
+    unichar atlas_glyph_ranges[] =
+    {
+        0x3000, 0x30FF, // NOTE(dan): cjk symbols and punctuation, hiragana, katakana
+        0x3400, 0x4DBF, // NOTE(dan): cjk unified ideographs extension a
+        0x4E00, 0x9FFF, // NOTE(dan): cjk unified ideographs
+        0xAC00, 0xD7A3, // NOTE(dan): hangul syllables
+        0xFF00, 0xFFEF, // NOTE(dan): halfwidth and fullwidth forms
         0
     };
     char *default_font = get_default_font();
     char *default_texture = get_default_texture();
 
-    Font *font = &ui->current_font;
+    Font *font = ui->current_font;
     font->size = 13.0f;
     font->texture_width = 256;
     font->texture_height = 0;
@@ -426,37 +2412,56 @@ static void init_default_ui_texture(UIState *ui)
         u8 *decompressed_font = (u8 *)push_size(&ui->font_memory, decompressed_font_size);
         stb_decompress(decompressed_font, decoded_font, decoded_font_size);
 
-        u32 num_glyphs = 0;
-        u32 num_glyph_ranges = 0;
+        u32 num_codepoints = 0;
         u32 font_offset = stbtt_GetFontOffsetForIndex(decompressed_font, 0);
 
-        // stbtt_fontinfo font_info;
-        stbtt_fontinfo *font_info = &font->font_info;
+        // NOTE(dan): the glyph atlas keeps the font to rasterize from
+        GlyphAtlas *atlas = push_struct(&ui->font_memory, GlyphAtlas);
+        ui->glyph_atlas = atlas;
+
+        stbtt_fontinfo *font_info = &atlas->font_info;
         stbtt_InitFont(font_info, decompressed_font, font_offset);
 
         for (unichar *glyph_range = glyph_ranges; glyph_range[0] && glyph_range[1]; glyph_range += 2)
         {
-            num_glyphs += (glyph_range[1] - glyph_range[0]) + 1;
-            ++num_glyph_ranges;
+            num_codepoints += (glyph_range[1] - glyph_range[0]) + 1;
+        }
+
+        // NOTE(dan): only the codepoints the font has a glyph for are packed
+        i32 *codepoints = push_array(&ui->font_memory, num_codepoints, i32, no_clear());
+        u32 num_glyphs = 0;
+        for (unichar *glyph_range = glyph_ranges; glyph_range[0] && glyph_range[1]; glyph_range += 2)
+        {
+            for (unichar codepoint = glyph_range[0]; codepoint <= glyph_range[1]; ++codepoint)
+            {
+                if (stbtt_FindGlyphIndex(font_info, codepoint))
+                {
+                    codepoints[num_glyphs++] = (i32)codepoint;
+                }
+            }
+        }
+
+        u32 num_atlas_glyphs = 0;
+        for (unichar *glyph_range = atlas_glyph_ranges; glyph_range[0] && glyph_range[1]; glyph_range += 2)
+        {
+            for (unichar codepoint = glyph_range[0]; codepoint <= glyph_range[1]; ++codepoint)
+            {
+                if (stbtt_FindGlyphIndex(font_info, codepoint))
+                {
+                    ++num_atlas_glyphs;
+                }
+            }
         }
 
+        u32 num_glyph_ranges = 1;
         stbtt_packedchar *packed_chars  = push_array(&ui->font_memory, num_glyphs, stbtt_packedchar);
         stbtt_pack_range *packed_ranges = push_array(&ui->font_memory, num_glyph_ranges, stbtt_pack_range);
         stbrp_rect *packed_rects        = push_array(&ui->font_memory, num_glyphs, stbrp_rect);
-        
-        u32 num_packed_chars = 0;
-        for (u32 glyph_range_index = 0; glyph_range_index < num_glyph_ranges; ++glyph_range_index)
-        {
-            unichar *glyph_range = glyph_ranges + (2 * glyph_range_index);
-            stbtt_pack_range *packed_range = packed_ranges + glyph_range_index;
 
-            packed_range->font_size = font->size;
-            packed_range->first_unicode_codepoint_in_range = glyph_range[0];
-            packed_range->num_chars = (glyph_range[1] - glyph_range[0]) + 1;
-            packed_range->chardata_for_range = packed_chars + num_packed_chars;
-
-            num_packed_chars += packed_range->num_chars;
-        }
+        packed_ranges->font_size = font->size;
+        packed_ranges->array_of_unicode_codepoints = codepoints;
+        packed_ranges->num_chars = num_glyphs;
+        packed_ranges->chardata_for_range = packed_chars;
 
         stbtt_pack_context pack_context;
         stbtt_PackBegin(&pack_context, 0, font->texture_width, 1024 * 32, 0, 1, 0);
@@ -518,6 +2523,9 @@ static void init_default_ui_texture(UIState *ui)
         font->descent = font_scale * unscaled_descent;
         font->num_glyphs = 0;
 
+        assert(num_glyphs + num_atlas_glyphs < MISSING_GLYPH);
+        font->glyphs = push_array(&ui->font_memory, num_glyphs + num_atlas_glyphs, Glyph);
+
         for (u32 glyph_range_index = 0; glyph_range_index < num_glyph_ranges; ++glyph_range_index)
         {
             stbtt_pack_range *packed_range = packed_ranges + glyph_range_index;
@@ -533,10 +2541,9 @@ static void init_default_ui_texture(UIState *ui)
                     stbtt_aligned_quad quad;
                     stbtt_GetPackedQuad(packed_range->chardata_for_range, font->texture_width, font->texture_height, char_index, &x, &y, &quad, 0);
 
-                    assert(font->num_glyphs < array_count(font->glyphs));
                     Glyph *glyph = font->glyphs + font->num_glyphs++;
                     
-                    glyph->codepoint = (unichar)(packed_range->first_unicode_codepoint_in_range + char_index);
+                    glyph->codepoint = (unichar)packed_range->array_of_unicode_codepoints[char_index];
                     glyph->advance_x = packed_char->xadvance;
                     
                     glyph->min_pos = v2(quad.x0, quad.y0);
@@ -549,15 +2556,51 @@ static void init_default_ui_texture(UIState *ui)
                 }
             }
         }
+        u32 num_baked_glyphs = font->num_glyphs;
+
+        atlas->font_scale = font_scale;
+        atlas->pixels = push_array(&ui->font_memory, GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT, u32, no_clear());
+        for (u32 pixel_index = 0; pixel_index < GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT; ++pixel_index)
+        {
+            atlas->pixels[pixel_index] = 0xFFFFFF;
+        }
+        atlas->dirty_min_y = GLYPH_ATLAS_HEIGHT;
+        atlas->dirty_max_y = 0;
+        for (u32 band_index = 0; band_index < NUM_GLYPH_ATLAS_BANDS; ++band_index)
+        {
+            reset_glyph_atlas_band(atlas, band_index);
+        }
 
-        for (u32 glyph_index = 0; glyph_index < font->num_glyphs; ++glyph_index)
+        // NOTE(dan): only the metrics of the atlas glyphs are read here
+        for (unichar *glyph_range = atlas_glyph_ranges; glyph_range[0] && glyph_range[1]; glyph_range += 2)
         {
-            unichar codepoint = font->glyphs[glyph_index].codepoint;
+            for (unichar codepoint = glyph_range[0]; codepoint <= glyph_range[1]; ++codepoint)
+            {
+                i32 font_glyph_index = stbtt_FindGlyphIndex(font_info, codepoint);
+                if (font_glyph_index && font->num_glyphs < num_glyphs + num_atlas_glyphs)
+                {
+                    i32 unscaled_advance_x;
+                    i32 unscaled_left_side_bearing;
+                    stbtt_GetGlyphHMetrics(font_info, font_glyph_index, &unscaled_advance_x, &unscaled_left_side_bearing);
+
+                    i32 x0, y0, x1, y1;
+                    stbtt_GetGlyphBitmapBox(font_info, font_glyph_index, font_scale, font_scale, &x0, &y0, &x1, &y1);
+
+                    Glyph *glyph = font->glyphs + font->num_glyphs++;
 
-            font->advance_x_lut[codepoint] = font->glyphs[glyph_index].advance_x;
-            font->glyph_index_lut[codepoint] = (u16)glyph_index;
+                    glyph->codepoint = codepoint;
+                    glyph->advance_x = font_scale * unscaled_advance_x;
+                    glyph->min_pos = v2((f32)x0, (f32)y0 + font->ascent);
+                    glyph->max_pos = v2((f32)x1, (f32)y1 + font->ascent);
+                    glyph->font_glyph_index = font_glyph_index;
+                }
+            }
         }
 
+        init_glyph_pages(&ui->font_memory, font);
+        init_kern_pairs(&ui->font_memory, font, font_info, font_scale, num_baked_glyphs);
+        init_sdf_font(&ui->font_memory, ui->sdf_font, font_info, codepoints, num_glyphs);
+
         for (u32 pixel_index = font->texture_width * font->texture_height - 1; pixel_index; --pixel_index)
         {
             u32 *dest_pixel = (u32 *)font->texture_pixels + pixel_index;
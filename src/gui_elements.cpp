@@ -5,6 +5,17 @@ inline void begin_ui(UIState *ui, u32 window_width, u32 window_height)
     ui->min_pos = v2(0, 0);
     ui->max_pos = v2((f32)window_width, (f32)window_height);
 
+    ++ui->frame_index;
+    ui->clip_rect = r2(ui->min_pos, ui->max_pos);
+    ui->draw_origin = v2(0.0f, 0.0f);
+
+    // NOTE(dan): the other stack holds the geometry recorded last frame
+    ui->geometry_memory_index = !ui->geometry_memory_index;
+    u32 memory_index = ui->geometry_memory_index;
+    end_temp_memory(ui->geometry_frame_memory[memory_index]);
+    ui->geometry_frame_memory[memory_index] = begin_temp_memory(ui->geometry_memory + memory_index);
+    ui->num_geometry_checkpoints = 0;
+
     ui->prev_mouse_pos = ui->mouse_pos;
     ui->mouse_pos = v2((f32)input->mouse_pos[0], (f32)input->mouse_pos[1]);
     ui->delta_mouse_pos = v2((f32)input->delta_mouse_pos[0], (f32)input->delta_mouse_pos[1]);
@@ -13,6 +24,24 @@ inline void begin_ui(UIState *ui, u32 window_width, u32 window_height)
     {
         ui->clicked_at = ui->mouse_pos;
     }
+
+    if (input->num_events)
+    {
+        ui->num_settle_frames = NUM_IDLE_SETTLE_FRAMES;
+    }
+}
+
+// NOTE(dan): for animations, asks for the next frame right away or in seconds, has to be asked again every frame
+inline void request_frame(UIState *ui, f32 seconds = 0.0f)
+{
+    if (seconds > 0.0f)
+    {
+        ui->wakeup_seconds = (ui->wakeup_seconds > 0.0f && ui->wakeup_seconds < seconds) ? ui->wakeup_seconds : seconds;
+    }
+    else
+    {
+        ui->frame_requested = true;
+    }
 }
 
 inline b32 is_mouse_down(UIState *ui, MouseButtonID button_id)
@@ -107,12 +136,474 @@ static Panel *get_or_create_panel(UIState *ui, char *name, Panel *parent = 0)
     return panel;
 }
 
+// NOTE(dan): cuts the rect around the first occluder that overlaps it, then the pieces have to be covered by the rest
+static b32 is_rect_covered(rect2 rect, rect2 *occluders, u32 num_occluders)
+{
+    b32 covered = false;
+    for (u32 occluder_index = 0; occluder_index < num_occluders; ++occluder_index)
+    {
+        rect2 occluder = occluders[occluder_index];
+        if (rect2_overlaps(rect, occluder))
+        {
+            f32 min_y = (rect.min_pos.y > occluder.min_pos.y) ? rect.min_pos.y : occluder.min_pos.y;
+            f32 max_y = (rect.max_pos.y < occluder.max_pos.y) ? rect.max_pos.y : occluder.max_pos.y;
+
+            u32 num_pieces = 0;
+            rect2 pieces[4];
+            if (rect.min_pos.y < occluder.min_pos.y)
+            {
+                pieces[num_pieces++] = r2(rect.min_pos, v2(rect.max_pos.x, occluder.min_pos.y));
+            }
+            if (rect.max_pos.y > occluder.max_pos.y)
+            {
+                pieces[num_pieces++] = r2(v2(rect.min_pos.x, occluder.max_pos.y), rect.max_pos);
+            }
+            if (rect.min_pos.x < occluder.min_pos.x)
+            {
+                pieces[num_pieces++] = r2(v2(rect.min_pos.x, min_y), v2(occluder.min_pos.x, max_y));
+            }
+            if (rect.max_pos.x > occluder.max_pos.x)
+            {
+                pieces[num_pieces++] = r2(v2(occluder.max_pos.x, min_y), v2(rect.max_pos.x, max_y));
+            }
+
+            covered = true;
+            for (u32 piece_index = 0; covered && piece_index < num_pieces; ++piece_index)
+            {
+                covered = is_rect_covered(pieces[piece_index], occluders + occluder_index + 1, num_occluders - occluder_index - 1);
+            }
+            break;
+        }
+    }
+    return covered;
+}
+
+#define MAX_NUM_OCCLUDERS 16
+
+// NOTE(dan): the panels above are the ones after this one, only called once every panel was begun so that the bounds are 
+//            all from this frame
+static b32 is_panel_occluded(UIState *ui, Panel *panel)
+{
+    u32 num_occluders = 0;
+    rect2 occluders[MAX_NUM_OCCLUDERS];
+
+    Panel *sentinel = get_panel_sentinel(panel->parent);
+    for (Panel *above = panel->next; above != sentinel && num_occluders < MAX_NUM_OCCLUDERS; above = above->next)
+    {
+        b32 begun_this_frame = (above->frame_index == ui->frame_index);
+        if (above->opaque && begun_this_frame && !(above->flags & PanelFlag_Hidden) && rect2_overlaps(above->bounds, panel->bounds))
+        {
+            occluders[num_occluders++] = above->bounds;
+        }
+    }
+
+    b32 occluded = is_rect_covered(panel->bounds, occluders, num_occluders);
+    return occluded;
+}
+
+inline u32 get_command_counter(DrawCommandType type)
+{
+    u32 counter = UploadCounter_Vertices;
+    switch (type)
+    {
+        case DrawCommand_Elements:  { counter = UploadCounter_Elements; } break;
+        case DrawCommand_Instances: { counter = UploadCounter_Instances; } break;
+        case DrawCommand_Shapes:    { counter = UploadCounter_Shapes; } break;
+    }
+    return counter;
+}
+
+static PanelGeometry *push_panel_geometry(UIState *ui, u32 num_checkpoints, u32 *counts, u32 num_commands)
+{
+    MemoryStack *memory = ui->geometry_memory + ui->geometry_memory_index;
+
+    PanelGeometry *geometry = push_struct(memory, PanelGeometry, no_clear());
+    geometry->num_checkpoints = num_checkpoints;
+    geometry->checkpoints = push_array(memory, num_checkpoints + 1, GeometryCheckpoint, no_clear());
+    geometry->num_commands = num_commands;
+    geometry->commands = push_array(memory, num_commands, DrawCommand, no_clear());
+
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        UploadStream *upload_stream = ui->upload_streams + stream_index;
+        geometry->streams[stream_index] = (u8 *)push_size(memory, counts[upload_stream->counter] * upload_stream->element_size, no_clear());
+    }
+    return geometry;
+}
+
+// NOTE(dan): the panel emitted exactly what it did last frame
+static PanelGeometry *copy_panel_geometry(UIState *ui, PanelGeometry *source)
+{
+    u32 *counts = source->checkpoints[source->num_checkpoints].counts;
+    PanelGeometry *geometry = push_panel_geometry(ui, source->num_checkpoints, counts, source->num_commands);
+    geometry->glyph_atlas_bands = source->glyph_atlas_bands;
+
+    copy_memory(geometry->checkpoints, source->checkpoints, (source->num_checkpoints + 1) * sizeof(GeometryCheckpoint));
+    copy_memory(geometry->commands, source->commands, source->num_commands * sizeof(DrawCommand));
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        UploadStream *upload_stream = ui->upload_streams + stream_index;
+        copy_memory(geometry->streams[stream_index], source->streams[stream_index], counts[upload_stream->counter] * upload_stream->element_size);
+    }
+    return geometry;
+}
+
+// NOTE(dan): reads back what the panel emitted, the streams have to be in system memory, see begin_panel_geometry
+static PanelGeometry *record_panel_geometry(UIState *ui, Panel *panel)
+{
+    u32 counts[UploadCounter_Count];
+    get_upload_counts(ui, counts);
+    for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+    {
+        counts[counter] -= panel->geometry_begin[counter];
+    }
+
+    u32 num_checkpoints = panel->num_signatures;
+    u32 num_commands = ui->num_commands - panel->begin_command_index;
+    PanelGeometry *geometry = push_panel_geometry(ui, num_checkpoints, counts, num_commands);
+    geometry->glyph_atlas_bands = panel->glyph_atlas_bands;
+
+    copy_memory(geometry->checkpoints, ui->geometry_checkpoints + panel->begin_checkpoint_index, num_checkpoints * sizeof(GeometryCheckpoint));
+    GeometryCheckpoint *end_checkpoint = geometry->checkpoints + num_checkpoints;
+    end_checkpoint->signature = 0;
+    for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+    {
+        end_checkpoint->counts[counter] = counts[counter];
+    }
+
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        UploadStream *upload_stream = ui->upload_streams + stream_index;
+        u32 counter = upload_stream->counter;
+        u8 *source = upload_stream->base + panel->geometry_begin[counter] * upload_stream->element_size;
+
+        if (counter == UploadCounter_Elements)
+        {
+            GLuint *source_elements = (GLuint *)source;
+            GLuint *elements = (GLuint *)geometry->streams[stream_index];
+            for (u32 element_index = 0; element_index < counts[counter]; ++element_index)
+            {
+                elements[element_index] = source_elements[element_index] - panel->geometry_begin[UploadCounter_Vertices];
+            }
+        }
+        else
+        {
+            copy_memory(geometry->streams[stream_index], source, counts[counter] * upload_stream->element_size);
+        }
+    }
+
+    for (u32 command_index = 0; command_index < num_commands; ++command_index)
+    {
+        DrawCommand *command = geometry->commands + command_index;
+        *command = ui->commands[panel->begin_command_index + command_index];
+        command->first -= panel->geometry_begin[get_command_counter(command->type)];
+    }
+    return geometry;
+}
+
+// NOTE(dan): emits the cached geometry of the widgets before the checkpoint
+static void replay_panel_geometry(UIState *ui, Panel *panel, u32 checkpoint_index)
+{
+    PanelGeometry *geometry = panel->geometry;
+    u32 *end_counts = geometry->checkpoints[checkpoint_index].counts;
+
+    if (geometry->glyph_atlas_bands)
+    {
+        keep_glyph_atlas_bands(ui, geometry->glyph_atlas_bands);
+        panel->glyph_atlas_bands |= geometry->glyph_atlas_bands;
+    }
+
+    u32 counts[UploadCounter_Count];
+    get_upload_counts(ui, counts);
+
+    assert(counts[UploadCounter_Vertices] + end_counts[UploadCounter_Vertices] <= MAX_NUM_VERTICES);
+    assert(counts[UploadCounter_Elements] + end_counts[UploadCounter_Elements] <= MAX_NUM_ELEMENTS);
+    assert(counts[UploadCounter_Instances] + end_counts[UploadCounter_Instances] <= MAX_NUM_INSTANCES);
+    assert(counts[UploadCounter_Shapes] + end_counts[UploadCounter_Shapes] <= MAX_NUM_SHAPES);
+
+    for (u32 stream_index = 0; stream_index < NUM_UPLOAD_STREAMS; ++stream_index)
+    {
+        UploadStream *upload_stream = ui->upload_streams + stream_index;
+        u32 counter = upload_stream->counter;
+        u8 *dest = upload_stream->base + counts[counter] * upload_stream->element_size;
+
+        if (counter == UploadCounter_Elements)
+        {
+            GLuint *source_elements = (GLuint *)geometry->streams[stream_index];
+            GLuint *elements = (GLuint *)dest;
+            for (u32 element_index = 0; element_index < end_counts[counter]; ++element_index)
+            {
+                elements[element_index] = source_elements[element_index] + counts[UploadCounter_Vertices];
+            }
+        }
+        else
+        {
+            copy_memory(dest, geometry->streams[stream_index], end_counts[counter] * upload_stream->element_size);
+        }
+    }
+
+    // NOTE(dan): the last command can reach past the checkpoint when it was merged with the next widget
+    for (u32 command_index = 0; command_index < geometry->num_commands; ++command_index)
+    {
+        DrawCommand *cached_command = geometry->commands + command_index;
+        u32 counter = get_command_counter(cached_command->type);
+        u32 stride = (cached_command->type == DrawCommand_Quads) ? 4 : 1;
+
+        u32 count = 0;
+        if (cached_command->first < end_counts[counter])
+        {
+            count = min(cached_command->count, (end_counts[counter] - cached_command->first) / stride);
+        }
+
+        if (count)
+        {
+            DrawCommand *command = get_draw_command(ui, cached_command->type, counts[counter] + cached_command->first);
+            command->count += count;
+        }
+    }
+
+    ui->num_vertices += end_counts[UploadCounter_Vertices];
+    ui->num_elements += end_counts[UploadCounter_Elements];
+    ui->num_instances += end_counts[UploadCounter_Instances];
+    ui->num_shapes += end_counts[UploadCounter_Shapes];
+    ui->num_cached_vertices += end_counts[UploadCounter_Vertices] + 4 * (end_counts[UploadCounter_Instances] + end_counts[UploadCounter_Shapes]);
+}
+
+// NOTE(dan): widgets pass everything their geometry depends on as the signature, as long as the signatures of a panel 
+//            match last frame's the widgets skip emitting, the cached geometry is emitted when they stop matching
+static b32 is_geometry_cached(UIState *ui, u64 signature)
+{
+    Panel *panel = ui->current_panel;
+    b32 cached = false;
+
+    if (panel->replay_geometry || panel->record_geometry || panel->cache_texture)
+    {
+        u32 signature_index = panel->num_signatures++;
+        panel->signature = (panel->signature ^ signature) * 0x100000001B3ull;
+
+        if (panel->replay_geometry)
+        {
+            PanelGeometry *geometry = panel->geometry;
+            cached = (signature_index < geometry->num_checkpoints && geometry->checkpoints[signature_index].signature == panel->signature);
+            if (!cached)
+            {
+                replay_panel_geometry(ui, panel, signature_index);
+                panel->replay_geometry = false;
+            }
+        }
+
+        if (panel->record_geometry && ui->num_geometry_checkpoints < MAX_NUM_GEOMETRY_CHECKPOINTS)
+        {
+            GeometryCheckpoint *checkpoint = ui->geometry_checkpoints + ui->num_geometry_checkpoints++;
+            checkpoint->signature = panel->signature;
+
+            u32 counts[UploadCounter_Count];
+            get_upload_counts(ui, counts);
+            for (u32 counter = 0; counter < UploadCounter_Count; ++counter)
+            {
+                checkpoint->counts[counter] = cached ? panel->geometry->checkpoints[signature_index].counts[counter] : 
+                                                       counts[counter] - panel->geometry_begin[counter];
+            }
+        }
+        else
+        {
+            panel->record_geometry = false;
+        }
+    }
+    return cached;
+}
+
+// NOTE(dan): a child panel emits in the middle of its parent, the parent cannot be replayed or recorded around it
+inline void break_panel_geometry(UIState *ui, Panel *panel)
+{
+    if (panel && panel != ui->root_panel)
+    {
+        if (panel->replay_geometry)
+        {
+            replay_panel_geometry(ui, panel, panel->num_signatures);
+            panel->replay_geometry = false;
+        }
+        panel->record_geometry = false;
+    }
+}
+
+inline void begin_panel_geometry(UIState *ui, Panel *panel, b32 begun_last_frame)
+{
+    // NOTE(dan): streamed frames are built right into the mapped region, reading that back is uncached, only retained and 
+    //            pipelined frames are built in system memory
+    b32 readable_streams = (ui->frame_retained || ui->frame_pipelined);
+    b32 cacheable = (ui->cache_geometry && readable_streams && (panel->flags & PanelFlag_CacheGeometry));
+    panel->replay_geometry = (cacheable && begun_last_frame && panel->geometry);
+    panel->record_geometry = cacheable;
+    panel->cache_texture = (ui->cache_textures && (panel->flags & PanelFlag_CacheTexture) && panel->opaque);
+    panel->signature = FNV_HASH_SEED;
+    panel->num_signatures = 0;
+    panel->glyph_atlas_bands = 0;
+    panel->begin_checkpoint_index = ui->num_geometry_checkpoints;
+    get_upload_counts(ui, panel->geometry_begin);
+
+    if (!panel->replay_geometry)
+    {
+        panel->geometry = 0;
+    }
+}
+
+inline void end_panel_geometry(UIState *ui, Panel *panel)
+{
+    b32 replayed_everything = false;
+    if (panel->replay_geometry)
+    {
+        replay_panel_geometry(ui, panel, panel->num_signatures);
+        replayed_everything = (panel->num_signatures == panel->geometry->num_checkpoints);
+    }
+
+    if (panel->record_geometry)
+    {
+        panel->geometry = replayed_everything ? copy_panel_geometry(ui, panel->geometry) : record_panel_geometry(ui, panel);
+    }
+    else
+    {
+        panel->geometry = 0;
+    }
+
+    panel->replay_geometry = false;
+    panel->record_geometry = false;
+    ui->num_geometry_checkpoints = panel->begin_checkpoint_index;
+}
+
+inline void release_panel_texture(UIState *ui, Panel *panel)
+{
+    PanelTexture *texture = panel->texture;
+    if (texture)
+    {
+        ui->num_panel_texture_bytes -= 4 * texture->width * texture->height;
+        texture->panel = 0;
+        texture->width = 0;
+        texture->height = 0;
+        panel->texture = 0;
+    }
+}
+
+// NOTE(dan): keeps the texture of the panel if it still fits, otherwise takes a free one and evicts the least recently 
+//            drawn ones until the budget allows it, textures drawn this frame are not evicted
+static PanelTexture *get_panel_texture(UIState *ui, Panel *panel, u32 width, u32 height)
+{
+    PanelTexture *texture = panel->texture;
+    if (texture && (texture->width != width || texture->height != height))
+    {
+        ui->num_panel_texture_bytes -= 4 * texture->width * texture->height;
+        texture->width = 0;
+        texture->height = 0;
+        texture->signature = 0;
+    }
+
+    u32 num_bytes = 4 * width * height;
+    u32 num_new_bytes = (texture && texture->width) ? 0 : num_bytes;
+    b32 fits = (num_bytes <= ui->panel_texture_budget);
+    while (fits && (!texture || ui->num_panel_texture_bytes + num_new_bytes > ui->panel_texture_budget))
+    {
+        PanelTexture *free_texture = 0;
+        PanelTexture *oldest_texture = 0;
+        for (u32 texture_index = 0; texture_index < MAX_NUM_PANEL_TEXTURES; ++texture_index)
+        {
+            PanelTexture *test_texture = ui->panel_textures + texture_index;
+            if (!test_texture->panel)
+            {
+                free_texture = test_texture;
+            }
+            else if (test_texture != texture && test_texture->last_used_frame != ui->frame_index &&
+                     (!oldest_texture || test_texture->last_used_frame < oldest_texture->last_used_frame))
+            {
+                oldest_texture = test_texture;
+            }
+        }
+
+        if (!texture && free_texture)
+        {
+            texture = free_texture;
+            texture->panel = panel;
+            texture->signature = 0;
+            panel->texture = texture;
+        }
+        else if (oldest_texture)
+        {
+            release_panel_texture(ui, oldest_texture->panel);
+        }
+        else
+        {
+            fits = false;
+        }
+    }
+
+    if (fits)
+    {
+        ui->num_panel_texture_bytes += num_new_bytes;
+        texture->width = width;
+        texture->height = height;
+        texture->last_used_frame = ui->frame_index;
+    }
+    else
+    {
+        release_panel_texture(ui, panel);
+        texture = 0;
+    }
+    return texture;
+}
+
+// NOTE(dan): the content signature of the panel covers everything it drew, the texture is redrawn when it changes, 
+//            the composite quad is emitted in its own command after the content
+static void end_panel_texture(UIState *ui, Panel *panel)
+{
+    panel->composite_command_index = ui->num_commands;
+    panel->texture_dirty = false;
+
+    if (panel->cache_texture)
+    {
+        rect2 bounds = panel->bounds;
+        i32 min_x = floor32(bounds.min_pos.x);
+        i32 min_y = floor32(bounds.min_pos.y);
+        i32 max_x = -floor32(-bounds.max_pos.x);
+        i32 max_y = -floor32(-bounds.max_pos.y);
+
+        vec2 origin = v2((f32)min_x, (f32)min_y);
+        vec2 offset = vec2_sub(bounds.min_pos, origin);
+        u32 width = (u32)(max_x - min_x);
+        u32 height = (u32)(max_y - min_y);
+
+        PanelTexture *texture = (width && height) ? get_panel_texture(ui, panel, width, height) : 0;
+        if (texture)
+        {
+            panel->texture_dirty = (texture->signature != panel->signature || !vec2_equal(texture->offset, offset));
+            ui->panel_textures_dirty = ui->panel_textures_dirty || panel->texture_dirty;
+            texture->signature = panel->signature;
+            texture->origin = origin;
+            texture->offset = offset;
+
+            // NOTE(dan): the texture is upside down, row 0 is the bottom of the panel
+            ui->command_barrier = ui->num_commands;
+            add_textured_quad(ui, origin, v2(origin.x + width, origin.y + height), v2(0.0f, 1.0f), v2(1.0f, 0.0f), 
+                              0xFFFFFFFF, PANEL_TEXTURE_SLOT);
+        }
+    }
+    else
+    {
+        release_panel_texture(ui, panel);
+    }
+    panel->cache_texture = false;
+}
+
 static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, Panel *parent = 0)
 {
+    break_panel_geometry(ui, ui->current_panel);
+
     Panel *panel = get_or_create_panel(ui, name, parent);
+    close_upload_segment(ui);
 
+    b32 begun_last_frame = (panel->frame_index + 1 == ui->frame_index);
     panel->flags = flags;
-    panel->begin_element_index = ui->num_elements;
+    panel->frame_index = ui->frame_index;
+    panel->begin_command_index = ui->num_commands;
+    ui->command_barrier = ui->num_commands;
 
     // NOTE(dan): panel overlaps
     if (is_mouse_clicked_in_rect(ui, mouse_button_left, panel->bounds))
@@ -151,7 +642,7 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
     {
         if (panel->flags & PanelFlag_HasHeader)
         {
-            header_bb.max_pos.y = header_bb.min_pos.y + ui->current_font.size + 2 * ui->panel_header_padding.y;
+            header_bb.max_pos.y = header_bb.min_pos.y + ui->current_font->size + 2 * ui->panel_header_padding.y;
         }
 
         if (is_mouse_down_in_rect(ui, mouse_button_left, header_bb) && ui->active_panel == panel)
@@ -209,21 +700,56 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
         }
     }
 
+    // NOTE(dan): panels that size themselves to their content clip with last frame's size
+    ui->clip_rect = panel->bounds;
+    panel->origin = ui->local_coords ? panel->bounds.min_pos : v2(0.0f, 0.0f);
+    ui->draw_origin = panel->origin;
+
+    // NOTE(dan): the background and the header cover the whole panel
+    u32 opaque_alpha = 0xFF000000;
+    panel->opaque = ((ui->colors[UIColor_PanelBackground] & opaque_alpha) == opaque_alpha);
+    if (panel->flags & PanelFlag_HasHeader)
+    {
+        panel->opaque = panel->opaque && ((ui->colors[UIColor_PanelHeaderBackground] & opaque_alpha) == opaque_alpha);
+    }
+
+    panel->begin_num_vertices = get_num_emitted_vertices(ui);
+    begin_panel_geometry(ui, panel, begun_last_frame);
+
+    // NOTE(dan): the clipping and instancing modes change what is emitted, with local coordinates only the size of 
+    //            the panel does
+    rect2 local_bounds = r2(get_local_pos(ui, panel->bounds.min_pos), get_local_pos(ui, panel->bounds.max_pos));
+    u64 signature = hash_words(FNV_HASH_SEED, &local_bounds, sizeof(local_bounds));
+    signature = hash_words(signature, &panel->flags, sizeof(panel->flags));
+    signature = hash_words(signature, ui->colors, sizeof(ui->colors));
+    signature = hash_words(signature, &ui->current_font->size, sizeof(ui->current_font->size));
+    signature = hash_words(signature, &ui->sdf_text, sizeof(ui->sdf_text));
+    signature = hash_words(signature, &ui->panel_header_padding, sizeof(ui->panel_header_padding));
+    signature = hash_words(signature, &ui->panel_padding, sizeof(ui->panel_padding));
+    signature = hash_words(signature, &ui->use_instancing, sizeof(ui->use_instancing));
+    signature = hash_words(signature, &ui->cpu_clipping, sizeof(ui->cpu_clipping));
+    signature = hash_words(signature, &ui->local_coords, sizeof(ui->local_coords));
+    signature = hash_string(signature, name);
+    b32 cached = is_geometry_cached(ui, signature);
+
     // NOTE(dan): draw header
     if (panel->flags & PanelFlag_HasHeader)
     {
-        rect2 bb = r2(panel->bounds.min_pos, panel->bounds.max_pos);
-        if (panel->flags & PanelFlag_Movable)
+        if (!cached)
         {
-            bb.max_pos.y = bb.min_pos.y + ui->current_font.size + 2 * ui->panel_header_padding.y;
-        }
+            rect2 bb = r2(panel->bounds.min_pos, panel->bounds.max_pos);
+            if (panel->flags & PanelFlag_Movable)
+            {
+                bb.max_pos.y = bb.min_pos.y + ui->current_font->size + 2 * ui->panel_header_padding.y;
+            }
 
-        u32 background_color = ui->colors[UIColor_PanelHeaderBackground];
-        u32 text_color       = ui->colors[UIColor_Text];
-        vec2 text_pos = vec2_add(panel->bounds.min_pos, ui->panel_header_padding);
+            u32 background_color = ui->colors[UIColor_PanelHeaderBackground];
+            u32 text_color       = ui->colors[UIColor_Text];
+            vec2 text_pos = vec2_add(panel->bounds.min_pos, ui->panel_header_padding);
 
-        add_rect_filled(ui, bb.min_pos, bb.max_pos, background_color);
-        add_text(ui, name, text_pos, ui->current_font.size, text_color);
+            add_rect_filled(ui, bb.min_pos, bb.max_pos, background_color);
+            add_text(ui, name, text_pos, ui->current_font->size, text_color);
+        }
 
         panel->layout_at.y += header_dim.y;
         panel->layout.min_pos.y += header_dim.y;
@@ -231,6 +757,7 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
     }
 
     // NOTE(dan): draw panel background
+    if (!cached)
     {
         u32 background_color = ui->colors[UIColor_PanelBackground];
         rect2 panel_bb = panel->bounds;
@@ -244,7 +771,7 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
     }
 
     // NOTE(dan): drwa panel border
-    if (panel->flags & PanelFlag_Bordered)
+    if (!cached && (panel->flags & PanelFlag_Bordered))
     {
         rect2 bounds = panel->bounds;
         u32 color = ui->colors[UIColor_PanelBorder];
@@ -253,7 +780,7 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
     }
 
     // NOTE(dan): draw scaler
-    if (panel->flags & PanelFlag_ResizableX || panel->flags & PanelFlag_ResizableY)
+    if (!cached && (panel->flags & PanelFlag_ResizableX || panel->flags & PanelFlag_ResizableY))
     {
         u32 color = ui->colors[UIColor_PanelBorder];
         vec2 vertices[] =
@@ -270,10 +797,21 @@ static Panel *begin_panel(UIState *ui, char *name, u32 flags = PanelFlag_None, P
 inline void end_panel(UIState *ui)
 {
     Panel *panel = ui->current_panel;
+    end_panel_geometry(ui, panel);
+    end_panel_texture(ui, panel);
+
+    panel->num_commands = ui->num_commands - panel->begin_command_index;
+    ui->command_barrier = ui->num_commands;
+    close_upload_segment(ui);
+
+    panel->num_vertices = get_num_emitted_vertices(ui) - panel->begin_num_vertices;
 
-    panel->num_elements = ui->num_elements - panel->begin_element_index;
-    
     ui->current_panel = panel->parent;
+
+    Panel *parent = panel->parent;
+    b32 parent_begun = (parent && parent->frame_index == ui->frame_index);
+    ui->clip_rect = parent_begun ? parent->bounds : r2(ui->min_pos, ui->max_pos);
+    ui->draw_origin = parent_begun ? parent->origin : v2(0.0f, 0.0f);
 }
 
 static Behavior button_behavior(UIState *ui, rect2 bounds)
@@ -303,7 +841,7 @@ static b32 button(UIState *ui, char *name)
 {
     Panel *panel = ui->current_panel;
     vec2 padding = ui->button_padding;
-    vec2 text_size = calc_text_size(ui, name, ui->current_font.size);
+    vec2 text_size = calc_text_size(ui, name, ui->current_font->size);
     vec2 button_size = vec2_add(text_size, vec2_mul(2.0f, padding));
 
     rect2 bounds = r2(panel->layout_at, vec2_add(panel->layout_at, button_size));
@@ -318,11 +856,20 @@ static b32 button(UIState *ui, char *name)
     {
         background_color = ui->colors[UIColor_ButtonBackgroundHover];
     }
-    add_rect_filled(ui, bounds.min_pos, bounds.max_pos, background_color);
-    
     u32 text_color = ui->colors[UIColor_Text];
-    vec2 text_pos = vec2_add(bounds.min_pos, padding);
-    add_text(ui, name, text_pos, ui->current_font.size, text_color);
+
+    rect2 local_bounds = r2(get_local_pos(ui, bounds.min_pos), get_local_pos(ui, bounds.max_pos));
+    u64 signature = hash_words(FNV_HASH_SEED, &local_bounds, sizeof(local_bounds));
+    signature = hash_words(signature, &background_color, sizeof(background_color));
+    signature = hash_words(signature, &text_color, sizeof(text_color));
+    signature = hash_string(signature, name);
+    if (!is_geometry_cached(ui, signature))
+    {
+        add_rect_filled(ui, bounds.min_pos, bounds.max_pos, background_color);
+        
+        vec2 text_pos = vec2_add(bounds.min_pos, padding);
+        add_text(ui, name, text_pos, ui->current_font->size, text_color);
+    }
 
     panel->current_line_height = max(panel->current_line_height, button_size.y);
     panel->layout_at.x += button_size.x;
@@ -333,6 +880,76 @@ static b32 button(UIState *ui, char *name)
     return pressed;
 }
 
+// NOTE(dan): the box and the check are paths in a unit square that is scaled to the box, checkboxes of the same size 
+//            share their flattened paths
+static b32 checkbox(UIState *ui, char *name, b32 *value)
+{
+    Panel *panel = ui->current_panel;
+    vec2 padding = ui->button_padding;
+    vec2 text_size = calc_text_size(ui, name, ui->current_font->size);
+    f32 box_size = text_size.y;
+    vec2 checkbox_size = v2(box_size + text_size.x + 3.0f * padding.x, text_size.y + 2.0f * padding.y);
+
+    rect2 bounds = r2(panel->layout_at, vec2_add(panel->layout_at, checkbox_size));
+    Behavior behavior = button_behavior(ui, bounds);
+
+    b32 changed = (behavior == Behavior_LeftClick);
+    if (changed)
+    {
+        *value = !*value;
+    }
+    
+    u32 background_color = ui->colors[UIColor_ButtonBackground];
+    if (behavior == Behavior_Active || behavior == Behavior_LeftClick)
+    {
+        background_color = ui->colors[UIColor_ButtonBackgroundActive];
+    }
+    else if (behavior == Behavior_Hover)
+    {
+        background_color = ui->colors[UIColor_ButtonBackgroundHover];
+    }
+    u32 text_color = ui->colors[UIColor_Text];
+    b32 checked = (*value != 0);
+
+    rect2 local_bounds = r2(get_local_pos(ui, bounds.min_pos), get_local_pos(ui, bounds.max_pos));
+    u64 signature = hash_words(FNV_HASH_SEED, &local_bounds, sizeof(local_bounds));
+    signature = hash_words(signature, &background_color, sizeof(background_color));
+    signature = hash_words(signature, &text_color, sizeof(text_color));
+    signature = hash_words(signature, &checked, sizeof(checked));
+    signature = hash_string(signature, name);
+    if (!is_geometry_cached(ui, signature))
+    {
+        vec2 box_pos = vec2_add(bounds.min_pos, padding);
+
+        begin_path(ui, box_pos, box_size);
+        path_arc_to(ui, v2(0.75f, 0.25f), 0.25f, 0.0f, 0.25f * TAU32);
+        path_arc_to(ui, v2(0.25f, 0.25f), 0.25f, 0.25f * TAU32, 0.5f * TAU32);
+        path_arc_to(ui, v2(0.25f, 0.75f), 0.25f, 0.5f * TAU32, 0.75f * TAU32);
+        path_arc_to(ui, v2(0.75f, 0.75f), 0.25f, 0.75f * TAU32, TAU32);
+        path_close(ui);
+        fill_path(ui, background_color);
+
+        if (checked)
+        {
+            begin_path(ui, box_pos, box_size);
+            path_move_to(ui, v2(0.25f, 0.5f));
+            path_line_to(ui, v2(0.45f, 0.7f));
+            path_line_to(ui, v2(0.75f, 0.3f));
+            stroke_path(ui, text_color, 0.15f * box_size, LineJoin_Round, LineCap_Round);
+        }
+
+        vec2 text_pos = v2(box_pos.x + box_size + padding.x, box_pos.y);
+        add_text(ui, name, text_pos, ui->current_font->size, text_color);
+    }
+
+    panel->current_line_height = max(panel->current_line_height, checkbox_size.y);
+    panel->layout_at.x += checkbox_size.x;
+    panel->layout_max.x = max(panel->layout_max.x, bounds.max_pos.x);
+    panel->layout_max.y = max(panel->layout_max.y, bounds.max_pos.y);
+
+    return changed;
+}
+
 inline Panel *begin_menu_bar(UIState *ui)
 {
     push_style_vec2(ui, panel_padding, ui->menu_bar_padding);
@@ -343,6 +960,9 @@ inline Panel *begin_menu_bar(UIState *ui)
     Panel *panel = begin_panel(ui, "Menu Bar");
     panel->bounds.min_pos = v2(0.0f, 0.0f);
     panel->bounds.max_pos = v2(ui->max_pos.x - ui->min_pos.x, ui->menu_bar_height);
+    ui->clip_rect = panel->bounds;
+    panel->origin = ui->local_coords ? panel->bounds.min_pos : v2(0.0f, 0.0f);
+    ui->draw_origin = panel->origin;
     return panel;
 }
 
@@ -358,6 +978,8 @@ inline void end_menu_bar(UIState *ui)
 
 static void remove_panel(UIState *ui, Panel *panel)
 {
+    release_panel_texture(ui, panel);
+
     panel->prev->next = panel->next;
     panel->next->prev = panel->prev;
 
@@ -369,7 +991,7 @@ static b32 begin_menu(UIState *ui, char *name)
     Panel *panel = ui->current_panel;
 
     vec2 padding = ui->button_padding;
-    vec2 text_size = calc_text_size(ui, name, ui->current_font.size);
+    vec2 text_size = calc_text_size(ui, name, ui->current_font->size);
     vec2 button_size = vec2_add(text_size, vec2_mul(2.0f, padding));
 
     rect2 bounds = r2(panel->layout_at, vec2_add(panel->layout_at, button_size));
@@ -384,11 +1006,20 @@ static b32 begin_menu(UIState *ui, char *name)
     {
         background_color = ui->colors[UIColor_ButtonBackgroundHover];
     }
-    add_rect_filled(ui, bounds.min_pos, bounds.max_pos, background_color);
-    
     u32 text_color = ui->colors[UIColor_Text];
-    vec2 text_pos = vec2_add(bounds.min_pos, padding);
-    add_text(ui, name, text_pos, ui->current_font.size, text_color);
+
+    rect2 local_bounds = r2(get_local_pos(ui, bounds.min_pos), get_local_pos(ui, bounds.max_pos));
+    u64 signature = hash_words(FNV_HASH_SEED, &local_bounds, sizeof(local_bounds));
+    signature = hash_words(signature, &background_color, sizeof(background_color));
+    signature = hash_words(signature, &text_color, sizeof(text_color));
+    signature = hash_string(signature, name);
+    if (!is_geometry_cached(ui, signature))
+    {
+        add_rect_filled(ui, bounds.min_pos, bounds.max_pos, background_color);
+        
+        vec2 text_pos = vec2_add(bounds.min_pos, padding);
+        add_text(ui, name, text_pos, ui->current_font->size, text_color);
+    }
 
     panel->layout_at.x += button_size.x;
     panel->layout_max.x = max(panel->layout_max.x, bounds.max_pos.x);
@@ -481,7 +1112,22 @@ inline void text_out(UIState *ui, char *text)
     Panel *panel = ui->current_panel;
     u32 color = ui->colors[UIColor_Text];
 
-    vec2 text_size = add_text(ui, text, panel->layout_at, ui->current_font.size, color);
+    vec2 local_pos = get_local_pos(ui, panel->layout_at);
+    u64 signature = hash_words(FNV_HASH_SEED, &local_pos, sizeof(local_pos));
+    signature = hash_words(signature, &color, sizeof(color));
+    signature = hash_words(signature, &ui->current_font->size, sizeof(ui->current_font->size));
+    signature = hash_words(signature, &ui->sdf_text, sizeof(ui->sdf_text));
+    signature = hash_string(signature, text);
+
+    vec2 text_size;
+    if (is_geometry_cached(ui, signature))
+    {
+        text_size = calc_text_size(ui, text, ui->current_font->size);
+    }
+    else
+    {
+        text_size = add_text(ui, text, panel->layout_at, ui->current_font->size, color);
+    }
     panel->layout_at.x += text_size.x;
     panel->current_line_height = max(panel->current_line_height, text_size.y);
 }
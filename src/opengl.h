@@ -3,6 +3,7 @@
 
 #define GL_FLOAT            0x1406
 #define GL_UNSIGNED_BYTE    0x1401
+#define GL_SHORT            0x1402
 #define GL_UNSIGNED_SHORT   0x1403
 #define GL_UNSIGNED_INT     0x1405
 
@@ -17,6 +18,7 @@
 #define GL_FUNC_ADD                       0x8006
 #define GL_LINEAR                         0x2601
 #define GL_LINK_STATUS                    0x8B82
+#define GL_ONE                            1
 #define GL_ONE_MINUS_SRC_ALPHA            0x0303
 #define GL_RGBA                           0x1908
 #define GL_SCISSOR_TEST                   0x0C11
@@ -28,10 +30,24 @@
 #define GL_TEXTURE_MAG_FILTER             0x2800
 #define GL_TEXTURE_MIN_FILTER             0x2801
 #define GL_TRIANGLES                      0x0004
+#define GL_TRIANGLE_STRIP                 0x0005
 #define GL_UNPACK_ROW_LENGTH              0x0CF2
 #define GL_VERTEX_SHADER                  0x8B31
 #define GL_WRITE_ONLY                     0x88B9
 
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT       0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#define GL_ALREADY_SIGNALED               0x911A
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_CONDITION_SATISFIED            0x911C
+#define GL_WAIT_FAILED                    0x911D
+
 #define GL_LINE_STRIP                     0x0003
 #define GL_QUADS                          0x0007
 #define GL_ALPHA                          0x1906
@@ -44,6 +60,13 @@
 
 #define GL_UNPACK_ALIGNMENT               0x0CF5
 #define GL_RED                            0x1903
+#define GL_RGBA8                          0x8058
+#define GL_FRAMEBUFFER                    0x8D40
+#define GL_COLOR_ATTACHMENT0              0x8CE0
+#define GL_TEXTURE_WRAP_S                 0x2802
+#define GL_TEXTURE_WRAP_T                 0x2803
+#define GL_CLAMP_TO_EDGE                  0x812F
+#define GL_NEAREST                        0x2600
 #define GL_RGB                            0x1907
 
 typedef unsigned int GLenum;
@@ -62,30 +85,49 @@ typedef double GLdouble;
 typedef double GLclampd;
 typedef void GLvoid;
 typedef intptr GLsizeiptr;
+typedef intptr GLintptr;
+typedef u64 GLuint64;
+typedef struct __GLsync *GLsync;
 typedef char GLchar;
 
 typedef void (__stdcall * PFNGLACTIVETEXTUREPROC) (GLenum texture);
 typedef void (__stdcall * PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+typedef void (__stdcall * PFNGLBINDFRAMEBUFFERPROC) (GLenum target, GLuint framebuffer);
 typedef void (__stdcall * PFNGLBINDTEXTUREPROC) (GLenum target, GLuint texture);
 typedef void (__stdcall * PFNGLBINDVERTEXARRAYPROC) (GLuint array);
 typedef void (__stdcall * PFNGLBLENDEQUATIONPROC) (GLenum mode);
 typedef void (__stdcall * PFNGLBLENDFUNCPROC) (GLenum sfactor, GLenum dfactor);
+typedef void (__stdcall * PFNGLBLENDFUNCSEPARATEPROC) (GLenum sfactor_rgb, GLenum dfactor_rgb, GLenum sfactor_alpha, GLenum dfactor_alpha);
 typedef void (__stdcall * PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void (__stdcall * PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+typedef void (__stdcall * PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
 typedef void (__stdcall * PFNGLCLEARCOLORPROC) (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
 typedef void (__stdcall * PFNGLCLEARPROC) (GLbitfield mask);
+typedef GLenum (__stdcall * PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (__stdcall * PFNGLDELETEFRAMEBUFFERSPROC) (GLsizei n, const GLuint *framebuffers);
+typedef void (__stdcall * PFNGLDELETESYNCPROC) (GLsync sync);
+typedef void (__stdcall * PFNGLDELETETEXTURESPROC) (GLsizei n, const GLuint *textures);
 typedef void (__stdcall * PFNGLDISABLEPROC) (GLenum cap);
 typedef void (__stdcall * PFNGLDISABLEVERTEXATTRIBARRAYPROC) (GLuint index);
 typedef void (__stdcall * PFNGLDRAWELEMENTSPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices);
+typedef void (__stdcall * PFNGLDRAWARRAYSINSTANCEDPROC) (GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef void (__stdcall * PFNGLDRAWELEMENTSBASEVERTEXPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex);
 typedef void (__stdcall * PFNGLENABLEPROC) (GLenum cap);
 typedef void (__stdcall * PFNGLENABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+typedef GLsync (__stdcall * PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (__stdcall * PFNGLFRAMEBUFFERTEXTURE2DPROC) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
 typedef void (__stdcall * PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
+typedef void (__stdcall * PFNGLGENFRAMEBUFFERSPROC) (GLsizei n, GLuint *framebuffers);
 typedef void (__stdcall * PFNGLGENTEXTURESPROC) (GLsizei n, GLuint *textures);
 typedef void (__stdcall * PFNGLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
 typedef void *(__stdcall * PFNGLMAPBUFFERPROC) (GLenum target, GLenum access);
+typedef void *(__stdcall * PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 typedef void (__stdcall * PFNGLSCISSORPROC) (GLint x, GLint y, GLsizei width, GLsizei height);
 typedef void (__stdcall * PFNGLTEXIMAGE2DPROC) (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
 typedef void (__stdcall * PFNGLTEXPARAMETERIPROC) (GLenum target, GLenum pname, GLint param);
+typedef void (__stdcall * PFNGLTEXSUBIMAGE2DPROC) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
 typedef GLboolean (__stdcall * PFNGLUNMAPBUFFERPROC) (GLenum target);
+typedef void (__stdcall * PFNGLVERTEXATTRIBDIVISORPROC) (GLuint index, GLuint divisor);
 typedef void (__stdcall * PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
 typedef void (__stdcall * PFNGLVIEWPORTPROC) (GLint x, GLint y, GLsizei width, GLsizei height);
 
@@ -106,7 +148,9 @@ typedef void (__stdcall * PFNGLLINKPROGRAMPROC) (GLuint program);
 typedef void (__stdcall * PFNGLUSEPROGRAMPROC) (GLuint program);
 typedef void (__stdcall * PFNGLSHADERSOURCEPROC) (GLuint shader, GLsizei count, const GLchar *const*string, const GLint *length);
 typedef void (__stdcall * PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
+typedef void (__stdcall * PFNGLUNIFORM1IVPROC) (GLint location, GLsizei count, const GLint *value);
 typedef void (__stdcall * PFNGLUNIFORM1FPROC) (GLint location, GLfloat v0);
+typedef void (__stdcall * PFNGLUNIFORM2FPROC) (GLint location, GLfloat v0, GLfloat v1);
 typedef void (__stdcall * PFNGLUNIFORMMATRIX4FVPROC) (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
 typedef void (__stdcall * PFNGLUNIFORM4FVPROC) (GLint location, GLsizei count, const GLfloat *value);
 
@@ -144,6 +188,7 @@ typedef void (__stdcall * PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROCARB callback
     GLCORE(BLENDFUNC,                   BlendFunc) \
     GLCORE(CLEAR,                       Clear) \
     GLCORE(CLEARCOLOR,                  ClearColor) \
+    GLCORE(DELETETEXTURES,              DeleteTextures) \
     GLCORE(DISABLE,                     Disable) \
     GLCORE(DRAWELEMENTS,                DrawElements) \
     GLCORE(ENABLE,                      Enable) \
@@ -151,6 +196,7 @@ typedef void (__stdcall * PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROCARB callback
     GLCORE(SCISSOR,                     Scissor) \
     GLCORE(TEXIMAGE2D,                  TexImage2D) \
     GLCORE(TEXPARAMETERI,               TexParameteri) \
+    GLCORE(TEXSUBIMAGE2D,               TexSubImage2D) \
     GLCORE(VIEWPORT,                    Viewport) \
     \
     GLCORE(VERTEX2F, Vertex2f) \
@@ -176,19 +222,31 @@ typedef void (__stdcall * PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROCARB callback
     GLCORE(ACTIVETEXTURE,               ActiveTexture) \
     GLCORE(ATTACHSHADER,                AttachShader) \
     GLCORE(BINDBUFFER,                  BindBuffer) \
+    GLCORE(BINDFRAMEBUFFER,             BindFramebuffer) \
     GLCORE(BINDATTRIBLOCATION,          BindAttribLocation) \
     GLCORE(BINDVERTEXARRAY,             BindVertexArray) \
     GLCORE(BLENDEQUATION,               BlendEquation) \
+    GLCORE(BLENDFUNCSEPARATE,           BlendFuncSeparate) \
     GLCORE(BUFFERDATA,                  BufferData) \
+    GLCORE(BUFFERSTORAGE,               BufferStorage) \
+    GLCORE(BUFFERSUBDATA,               BufferSubData) \
+    GLCORE(CLIENTWAITSYNC,              ClientWaitSync) \
     GLCORE(COMPILESHADER,               CompileShader) \
     GLCORE(CREATESHADER,                CreateShader) \
     GLCORE(DEBUGMESSAGECALLBACK,        DebugMessageCallback) \
+    GLCORE(DELETEFRAMEBUFFERS,          DeleteFramebuffers) \
     GLCORE(DELETESHADER,                DeleteShader) \
+    GLCORE(DELETESYNC,                  DeleteSync) \
     GLCORE(DETACHSHADER,                DetachShader) \
     GLCORE(DISABLEVERTEXATTRIBARRAY,    DisableVertexAttribArray) \
+    GLCORE(DRAWARRAYSINSTANCED,         DrawArraysInstanced) \
+    GLCORE(DRAWELEMENTSBASEVERTEX,      DrawElementsBaseVertex) \
     GLCORE(CREATEPROGRAM,               CreateProgram) \
     GLCORE(ENABLEVERTEXATTRIBARRAY,     EnableVertexAttribArray) \
+    GLCORE(FENCESYNC,                   FenceSync) \
+    GLCORE(FRAMEBUFFERTEXTURE2D,        FramebufferTexture2D) \
     GLCORE(GENBUFFERS,                  GenBuffers) \
+    GLCORE(GENFRAMEBUFFERS,             GenFramebuffers) \
     GLCORE(GENVERTEXARRAYS,             GenVertexArrays) \
     GLCORE(GETATTRIBLOCATION,           GetAttribLocation) \
     GLCORE(GETPROGRAMINFOLOG,           GetProgramInfoLog) \
@@ -198,13 +256,17 @@ typedef void (__stdcall * PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROCARB callback
     GLCORE(GETUNIFORMLOCATION,          GetUniformLocation) \
     GLCORE(LINKPROGRAM,                 LinkProgram) \
     GLCORE(MAPBUFFER,                   MapBuffer) \
+    GLCORE(MAPBUFFERRANGE,              MapBufferRange) \
     GLCORE(SHADERSOURCE,                ShaderSource) \
     GLCORE(UNIFORM1I,                   Uniform1i) \
+    GLCORE(UNIFORM1IV,                  Uniform1iv) \
     GLCORE(UNIFORM1F,                   Uniform1f) \
+    GLCORE(UNIFORM2F,                   Uniform2f) \
     GLCORE(UNIFORM4FV,                  Uniform4fv) \
     GLCORE(UNIFORMMATRIX4FV,            UniformMatrix4fv) \
     GLCORE(UNMAPBUFFER,                 UnmapBuffer) \
     GLCORE(USEPROGRAM,                  UseProgram) \
+    GLCORE(VERTEXATTRIBDIVISOR,         VertexAttribDivisor) \
     GLCORE(VERTEXATTRIBPOINTER,         VertexAttribPointer) \
 
 #define GLARB(a, b) GLCORE(a##ARB, b##ARB)
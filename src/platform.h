@@ -38,6 +38,9 @@
     #define ARCH    ARCH_32_BIT
 #endif
 
+// NOTE(dan): sse2 is the x64 baseline, only intrinsics, no crt
+#include <emmintrin.h>
+
 typedef unsigned char    u8;
 typedef   signed char    i8;
 typedef unsigned short  u16;
@@ -62,7 +65,7 @@ typedef i32    b32;
 typedef float  f32;
 typedef double f64;
 
-typedef u16 unichar;
+typedef u32 unichar;
 
 #if ARCH == ARCH_64_BIT
     typedef u64     usize;
@@ -126,9 +129,13 @@ typedef char test_size_usize[sizeof(usize) == sizeof(char *) ? 1 : -1];
     extern "C" long _InterlockedExchange(long volatile *target, long value);
     extern "C" __int64 _InterlockedExchange64(__int64 volatile *target, __int64 value);
     extern "C" long _InterlockedCompareExchange(long volatile *destination, long exchange, long comparand); 
-    extern "C" void _mm_pause();
     extern "C" unsigned __int64 __rdtsc();
     extern "C" unsigned __int64 __readgsqword(unsigned long offset);
+    extern "C" void _ReadWriteBarrier();
+    extern "C" unsigned char _BitScanForward(unsigned long *index, unsigned long mask);
+
+    // NOTE(dan): only keeps the compiler from moving loads and stores across it, x64 does not reorder stores
+    #define compiler_barrier() _ReadWriteBarrier()
 
     inline u32 atomic_add_u32(u32 volatile *addend, u32 value)
     {
@@ -163,6 +170,14 @@ typedef char test_size_usize[sizeof(usize) == sizeof(char *) ? 1 : -1];
         return result;
     }
 
+    // NOTE(dan): value must not be 0
+    inline u32 find_least_significant_set_bit(u32 value)
+    {
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return (u32)index;
+    }
+
     inline u32 get_thread_id()
     {
         u8 *thread_local_storage = (u8 *)__readgsqword(0x30);
@@ -265,6 +280,9 @@ struct PlatformInput
 
     PlatformButton buttons[256];
     PlatformButton mouse_buttons[mouse_button_count];
+
+    // NOTE(dan): window messages since the last frame, the app uses it to know when to stop asking for frames
+    u32 num_events;
 };
 
 inline b32 is_down(PlatformInput *input, u32 scan_code)
@@ -320,6 +338,19 @@ typedef PLATFORM_INIT_OPENGL(PlatformInitOpenGL);
 typedef PLATFORM_VIRTUAL_ALLOC(PlatformVirtualAlloc);
 typedef PLATFORM_VIRTUAL_FREE(PlatformVirtualFree);
 
+// NOTE(dan): work is picked up by the worker threads in the order it was added, complete_all_work helps with the 
+//            work that is left on the calling thread and returns when all of it is done
+struct PlatformWorkQueue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue *queue, void *data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(PlatformWorkQueueCallback);
+
+#define PLATFORM_ADD_WORK(name)          void name(PlatformWorkQueue *queue, PlatformWorkQueueCallback *callback, void *data)
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(PlatformWorkQueue *queue)
+
+typedef PLATFORM_ADD_WORK(PlatformAddWork);
+typedef PLATFORM_COMPLETE_ALL_WORK(PlatformCompleteAllWork);
+
 struct Platform
 {
     PlatformAllocate *allocate;
@@ -329,6 +360,9 @@ struct Platform
 
     PlatformVirtualAlloc *virtual_alloc;
     PlatformVirtualFree *virtual_free;
+
+    PlatformAddWork *add_work;
+    PlatformCompleteAllWork *complete_all_work;
 };
 
 extern Platform platform;
@@ -337,6 +371,9 @@ struct AppMemory
 {
     struct AppState *app_state;
     Platform platform;
+
+    // NOTE(dan): 0 when there are no worker threads
+    PlatformWorkQueue *work_queue;
 };
 
 struct Mutex
@@ -560,9 +597,36 @@ inline void check_memory_stack(MemoryStack *memstack)
     assert(memstack->temp_stacks == 0);
 }
 
-#define UPDATE_AND_RENDER(name) void name(AppMemory *memory, PlatformInput *input, i32 window_width, i32 window_height)
+// NOTE(dan): when the app does not want the next frame right away, the platform waits for input, 
+//            or for wakeup_seconds when that is not 0
+//            a queued frame is drawn by render_frame on the render thread of the platform, which has the gl context 
+//            for as long as the frames are pipelined, the next frame is built while it draws the last one
+struct PlatformFrame
+{
+    b32 rendered;
+    b32 queued;
+    b32 pipelined;
+    b32 wants_next_frame;
+    f32 wakeup_seconds;
+};
+
+// NOTE(dan): frames queued for the render thread that were not drawn yet when the next one is built, 
+//            the app needs one more frame than this to build into
+#define MAX_NUM_QUEUED_FRAMES 1
+
+#define UPDATE_AND_RENDER(name) PlatformFrame name(AppMemory *memory, PlatformInput *input, i32 window_width, i32 window_height)
 typedef UPDATE_AND_RENDER(UpdateAndRender);
 static UPDATE_AND_RENDER(update_and_render_stub)
+{
+    PlatformFrame frame = {};
+    frame.rendered = true;
+    frame.wants_next_frame = true;
+    return frame;
+}
+
+#define RENDER_FRAME(name) void name(AppMemory *memory)
+typedef RENDER_FRAME(RenderFrame);
+static RENDER_FRAME(render_frame_stub)
 {
 }
 
@@ -787,6 +851,7 @@ inline vec2 v2(f32 x, f32 y)
 #define vec2_mul(s, a)      v2( (s) * (a).x,  (s) * (a).y )
 #define vec2_inner(a, x)    ( (a).x * (b).x + (a).y * (b).y )
 #define vec2_hadamard(a, b) v2( (a).x * (b).x, (a).y * (b).y )
+#define vec2_equal(a, b)    ( ((a).x == (b).x) && ((a).y == (b).y) )
 
 #define vec2_length2(a)     ( (a).x * (a).x + (a).y * (a).y )
 #define vec2_length(a)      sqrt32(vec2_length2(a))
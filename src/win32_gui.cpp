@@ -284,6 +284,8 @@ static void win32_process_messages(PlatformInput *input)
     Win32Api_MSG msg;
     while (win32_api->PeekMessageA(&msg, 0, 0, 0, 0x0001 /* PM_REMOVE */))
     {
+        ++input->num_events;
+
         unsigned int message = msg.message;
         switch (message)
         {
@@ -319,6 +321,7 @@ static void win32_update_input(PlatformInput *input, f32 dt)
     input->delta_mouse_pos[1] = 0;
     input->delta_wheel = 0;
     input->wheel = 0;
+    input->num_events = 0;
 
     for (u32 mouse_button_index = 0; mouse_button_index < mouse_button_count; ++mouse_button_index)
     {
@@ -338,6 +341,13 @@ static void win32_update_input(PlatformInput *input, f32 dt)
     input->mouse_pos[1] = mouse_p.y;
 }
 
+// NOTE(dan): returns on the next message, or after timeout_seconds when that is not 0
+static void win32_wait_for_events(f32 timeout_seconds)
+{
+    unsigned int timeout = (timeout_seconds > 0.0f) ? (unsigned int)(timeout_seconds * 1000.0f) : 0xFFFFFFFF /* INFINITE */;
+    win32_api->MsgWaitForMultipleObjects(0, 0, 0, timeout, 0x04FF /* QS_ALLINPUT */);
+}
+
 static PLATFORM_ALLOCATE(win32_allocate)
 {
     assert(sizeof(Win32MemoryBlock) == 64);
@@ -424,6 +434,170 @@ static PLATFORM_INIT_OPENGL(win32_init_opengl)
     #undef GLCORE
 }
 
+static PLATFORM_ADD_WORK(win32_add_work)
+{
+    u32 entry_index = queue->next_entry_to_write;
+    u32 next_entry_to_write = (entry_index + 1) % MAX_NUM_WORK_QUEUE_ENTRIES;
+    assert(next_entry_to_write != queue->next_entry_to_read);
+
+    Win32WorkQueueEntry *entry = queue->entries + entry_index;
+    entry->callback = callback;
+    entry->data = data;
+    ++queue->completion_goal;
+
+    // NOTE(dan): the entry has to be written before the workers can see it
+    compiler_barrier();
+    queue->next_entry_to_write = next_entry_to_write;
+    win32_api->ReleaseSemaphore(queue->semaphore, 1, 0);
+}
+
+// NOTE(dan): returns false when there was nothing to do, the entry is taken by whoever moves next_entry_to_read past it
+static b32 win32_do_next_work_entry(PlatformWorkQueue *queue)
+{
+    b32 worked = false;
+
+    u32 entry_index = queue->next_entry_to_read;
+    if (entry_index != queue->next_entry_to_write)
+    {
+        u32 next_entry_to_read = (entry_index + 1) % MAX_NUM_WORK_QUEUE_ENTRIES;
+        if (atomic_cmpxchg_u32(&queue->next_entry_to_read, next_entry_to_read, entry_index) == entry_index)
+        {
+            Win32WorkQueueEntry entry = queue->entries[entry_index];
+            entry.callback(queue, entry.data);
+            atomic_add_u32(&queue->completion_count, 1);
+        }
+        worked = true;
+    }
+    return worked;
+}
+
+static PLATFORM_COMPLETE_ALL_WORK(win32_complete_all_work)
+{
+    while (queue->completion_count != queue->completion_goal)
+    {
+        if (!win32_do_next_work_entry(queue))
+        {
+            _mm_pause();
+        }
+    }
+
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+}
+
+static int __stdcall win32_worker_thread_proc(void *param)
+{
+    PlatformWorkQueue *queue = (PlatformWorkQueue *)param;
+    for (;;)
+    {
+        if (!win32_do_next_work_entry(queue))
+        {
+            win32_api->WaitForSingleObject(queue->semaphore, 0xFFFFFFFF /* INFINITE */);
+        }
+    }
+}
+
+// NOTE(dan): one worker per logical processor besides the main thread
+static void win32_init_work_queue(Win32State *state)
+{
+    PlatformWorkQueue *queue = &state->work_queue;
+    u32 num_processors = win32_api->GetActiveProcessorCount(0xFFFF /* ALL_PROCESSOR_GROUPS */);
+    u32 num_worker_threads = (num_processors > 1) ? num_processors - 1 : 0;
+    num_worker_threads = (num_worker_threads < MAX_NUM_WORKER_THREADS) ? num_worker_threads : MAX_NUM_WORKER_THREADS;
+
+    queue->semaphore = win32_api->CreateSemaphoreA(0, 0, MAX_NUM_WORK_QUEUE_ENTRIES, 0);
+    for (u32 thread_index = 0; thread_index < num_worker_threads; ++thread_index)
+    {
+        unsigned int thread_id = 0;
+        void *thread = win32_api->CreateThread(0, 0, win32_worker_thread_proc, queue, 0, &thread_id);
+        assert(thread);
+    }
+
+    state->app_memory.work_queue = num_worker_threads ? queue : 0;
+}
+
+static int __stdcall win32_render_thread_proc(void *param)
+{
+    Win32State *state = (Win32State *)param;
+    b32 has_context = false;
+    for (;;)
+    {
+        win32_api->WaitForSingleObject(state->render_semaphore, 0xFFFFFFFF /* INFINITE */);
+        if (state->release_context)
+        {
+            win32_api->wglMakeCurrent(state->window.dc, 0);
+            has_context = false;
+            state->release_context = false;
+        }
+        else
+        {
+            if (!has_context)
+            {
+                has_context = win32_api->wglMakeCurrent(state->window.dc, state->window.rc);
+                assert(has_context);
+            }
+
+            render_frame(&state->app_memory);
+            win32_api->SwapBuffers(state->window.dc);
+        }
+        win32_api->ReleaseSemaphore(state->rendered_semaphore, 1, 0);
+    }
+}
+
+static void win32_init_render_thread(Win32State *state)
+{
+    state->render_semaphore = win32_api->CreateSemaphoreA(0, 0, MAX_NUM_QUEUED_FRAMES + 1, 0);
+    state->rendered_semaphore = win32_api->CreateSemaphoreA(0, 0, MAX_NUM_QUEUED_FRAMES + 1, 0);
+
+    unsigned int thread_id = 0;
+    void *thread = win32_api->CreateThread(0, 0, win32_render_thread_proc, state, 0, &thread_id);
+    assert(thread);
+}
+
+inline void win32_wait_for_queued_frame(Win32State *state)
+{
+    win32_api->WaitForSingleObject(state->rendered_semaphore, 0xFFFFFFFF /* INFINITE */);
+    --state->num_queued_frames;
+}
+
+// NOTE(dan): blocks until the frames the app builds can use gl again, or until there is a frame packet to build into
+static void win32_sync_render_thread(Win32State *state, b32 pipelined)
+{
+    if (pipelined)
+    {
+        while (state->num_queued_frames > MAX_NUM_QUEUED_FRAMES)
+        {
+            win32_wait_for_queued_frame(state);
+        }
+    }
+    else if (state->context_on_render_thread)
+    {
+        while (state->num_queued_frames)
+        {
+            win32_wait_for_queued_frame(state);
+        }
+
+        state->release_context = true;
+        win32_api->ReleaseSemaphore(state->render_semaphore, 1, 0);
+        win32_api->WaitForSingleObject(state->rendered_semaphore, 0xFFFFFFFF /* INFINITE */);
+
+        win32_api->wglMakeCurrent(state->window.dc, state->window.rc);
+        state->context_on_render_thread = false;
+    }
+}
+
+static void win32_queue_frame(Win32State *state)
+{
+    if (!state->context_on_render_thread)
+    {
+        win32_api->wglMakeCurrent(state->window.dc, 0);
+        state->context_on_render_thread = true;
+    }
+
+    ++state->num_queued_frames;
+    win32_api->ReleaseSemaphore(state->render_semaphore, 1, 0);
+}
+
 static void win32_init_rawinput(Win32State *state)
 {
     Win32Api_RAWINPUTDEVICE device[2] = {0};
@@ -449,6 +623,9 @@ void WinMainCRTStartup()
     win32_state->app_memory.platform.virtual_alloc = win32_virtual_alloc;
     win32_state->app_memory.platform.virtual_free = win32_virtual_free;
 
+    win32_state->app_memory.platform.add_work = win32_add_work;
+    win32_state->app_memory.platform.complete_all_work = win32_complete_all_work;
+
     platform = win32_state->app_memory.platform;
 
     win32_state->memory_sentinel.prev = &win32_state->memory_sentinel;
@@ -456,28 +633,47 @@ void WinMainCRTStartup()
 
     win32_init_win32_api(win32_api);
     win32_init_rawinput(win32_state);
+    win32_init_work_queue(win32_state);
 
     win32_state->window = win32_open_window_init_with_opengl("Gui", 1280, 720, win32_window_proc);
     if (win32_state->window.rc)
     {
         win32_set_vsync(true);
+        win32_init_render_thread(win32_state);
 
         f32 t0 = win32_get_time();
         f32 dt = 0;
 
+        PlatformFrame frame = {};
+        frame.wants_next_frame = true;
+
         win32_state->running = true;
         while (win32_state->running)
         {
+            // NOTE(dan): idle, nothing happens until there is input or the app wants to be woken up
+            if (!frame.wants_next_frame)
+            {
+                win32_wait_for_events(frame.wakeup_seconds);
+            }
+
             win32_update_input(&win32_state->input, dt);
+            win32_sync_render_thread(win32_state, frame.pipelined);
 
-            update_and_render(&win32_state->app_memory, &win32_state->input, win32_state->window.width, win32_state->window.height);
+            frame = update_and_render(&win32_state->app_memory, &win32_state->input, win32_state->window.width, win32_state->window.height);
 
             if (win32_state->input.quit_requested)
             {
                 win32_state->running = false;
             }
 
-            win32_api->SwapBuffers(win32_state->window.dc);
+            if (frame.queued)
+            {
+                win32_queue_frame(win32_state);
+            }
+            else if (frame.rendered)
+            {
+                win32_api->SwapBuffers(win32_state->window.dc);
+            }
             f32 t1 = win32_get_time();
             dt = t1 - t0;
             t0 = t1;
@@ -319,14 +319,17 @@ static Win32Api_GUID Win32Api_uuid_IAudioCaptureClient = { 0xC8ADBD64, 0xE71E, 0
     \
     WIN32_API(kernel32, CompareFileTime, int __stdcall, (Win32Api_FILETIME *filetime1, Win32Api_FILETIME *filetime2)) \
     WIN32_API(kernel32, CopyFileA, int __stdcall, (char *filename, char *new_filename, int fail_if_exists)) \
+    WIN32_API(kernel32, CreateSemaphoreA, void * __stdcall, (void *semaphore_attributes, int initial_count, int maximum_count, char *name)) \
     WIN32_API(kernel32, CreateEventA, void * __stdcall, (void *event_attributes, int manual_reset, int initial_state, char *name)) \
     WIN32_API(kernel32, CreateThread, void * __stdcall, (void *thread_attributes, unsigned int stack_size, Win32Api_THREAD_START_ROUTINE proc, void *param, unsigned int creation_flags, unsigned int *thread_id)) \
+    WIN32_API(kernel32, GetActiveProcessorCount, unsigned int __stdcall, (unsigned short group_number)) \
     WIN32_API(kernel32, GetFileAttributesExA, int __stdcall, (char *filename, Win32Api_GET_FILEEX_INFO_LEVELS info_level_id, void *file_info)) \
     WIN32_API(kernel32, GetModuleFileNameA, unsigned int __stdcall, (void *module, char *filename, unsigned int size)) \
     WIN32_API(kernel32, GetModuleHandleA, void * __stdcall, (char *module)) \
     WIN32_API(kernel32, ExitProcess, void __stdcall, (unsigned int)) \
     WIN32_API(kernel32, QueryPerformanceCounter, int __stdcall, (Win32Api_LARGE_INTEGER *perf_count)) \
     WIN32_API(kernel32, QueryPerformanceFrequency, int __stdcall, (Win32Api_LARGE_INTEGER *freq)) \
+    WIN32_API(kernel32, ReleaseSemaphore, int __stdcall, (void *semaphore, int release_count, int *previous_count)) \
     WIN32_API(kernel32, SetThreadPriority, int __stdcall, (void *thread, int priority)) \
     WIN32_API(kernel32, VirtualAlloc, void * __stdcall, (void *addr, usize size, unsigned int alloc_type, unsigned int protect)) \
     WIN32_API(kernel32, VirtualFree, int __stdcall, (void *addr, usize size, usize free_type)) \
@@ -351,6 +354,7 @@ static Win32Api_GUID Win32Api_uuid_IAudioCaptureClient = { 0xC8ADBD64, 0xE71E, 0
     WIN32_API(user32, GetKeyState, short __stdcall, (int virtual_key)) \
     WIN32_API(user32, GetRawInputData, unsigned int __stdcall, (void *rawinput, unsigned int commad, void *data, unsigned int *cbSize, unsigned int cbSizeHeader)) \
     WIN32_API(user32, LoadCursorA, void * __stdcall, (void *instance, char *cursor_name)) \
+    WIN32_API(user32, MsgWaitForMultipleObjects, unsigned int __stdcall, (unsigned int count, void **handles, int wait_all, unsigned int milliseconds, unsigned int wake_mask)) \
     WIN32_API(user32, PeekMessageA, int __stdcall, (Win32Api_MSG *msg, void *wnd, unsigned int msg_filter_min, unsigned int msg_filter_max, unsigned int remove_msg)) \
     WIN32_API(user32, RegisterClassExA, unsigned short __stdcall, (Win32Api_WNDCLASSEXA *)) \
     WIN32_API(user32, RegisterRawInputDevices, int __stdcall, (Win32Api_RAWINPUTDEVICE *devices, unsigned int num_devices, unsigned int cbSize)) \
@@ -399,6 +403,28 @@ struct Win32MemoryBlock
     u64 flags;
 };
 
+struct Win32WorkQueueEntry
+{
+    PlatformWorkQueueCallback *callback;
+    void *data;
+};
+
+#define MAX_NUM_WORK_QUEUE_ENTRIES 256
+#define MAX_NUM_WORKER_THREADS 63
+
+// NOTE(dan): one producer, any number of consumers, the semaphore counts the entries that were not picked up yet
+struct PlatformWorkQueue
+{
+    u32 volatile completion_goal;
+    u32 volatile completion_count;
+
+    u32 volatile next_entry_to_write;
+    u32 volatile next_entry_to_read;
+    void *semaphore;
+
+    Win32WorkQueueEntry entries[MAX_NUM_WORK_QUEUE_ENTRIES];
+};
+
 struct Win32State
 {
     b32 running;
@@ -410,5 +436,15 @@ struct Win32State
     Mutex memory_mutex;
     Win32MemoryBlock memory_sentinel;
 
+    PlatformWorkQueue work_queue;
+
+    // NOTE(dan): the render thread draws a queued frame for every count of render_semaphore and counts 
+    //            rendered_semaphore up when it is done, or when it gave the gl context back
+    void *render_semaphore;
+    void *rendered_semaphore;
+    b32 volatile release_context;
+    b32 context_on_render_thread;
+    u32 num_queued_frames;
+
     b32 pause_scan_code_read;
 };